@@ -0,0 +1,83 @@
+#ifndef __BENCH_TYPES_HPP__
+#define __BENCH_TYPES_HPP__
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+#include "ListTestTypes.hpp"
+
+// Element types the benchmarks run on, based on the test types.
+struct IntElement {
+  typedef int value_type;
+  static List create() {
+    return list_create(int_copy, int_free, int_compare);
+  }
+  static void destroy(ListData * data) {
+    int_free(data);
+  }
+  static int make(long i) {
+    return (int)i;
+  }
+  static const ListData * data(const int & value) {
+    return &value;
+  }
+  // a cheap read of an element, to traverse without being optimized out
+  static long weigh(const ListData * data) {
+    return *(const int*)data;
+  }
+  static long weigh(const int & value) {
+    return value;
+  }
+};
+
+struct StringElement {
+  typedef std::string value_type;
+  static List create() {
+    return list_create(string_copy, string_free, string_compare);
+  }
+  static void destroy(ListData * data) {
+    string_free(data);
+  }
+  static std::string make(long i) {
+    return "string #" + std::to_string(i);
+  }
+  static const ListData * data(const std::string & value) {
+    return value.c_str();
+  }
+  static long weigh(const ListData * data) {
+    return *(const char*)data;
+  }
+  static long weigh(const std::string & value) {
+    return value[0];
+  }
+};
+
+// The values 0..n-1 of an element type, in a fixed random order.
+template <class E>
+std::vector<typename E::value_type> make_values(long n) {
+  std::vector<typename E::value_type> values;
+  values.reserve(n);
+  for (long i = 0; i < n; ++i) {
+    values.push_back(E::make(i));
+  }
+  std::shuffle(values.begin(), values.end(), std::mt19937(42));
+  return values;
+}
+
+template <class E>
+List make_list(const std::vector<typename E::value_type> & values) {
+  List list = E::create();
+  for (const auto & value : values) {
+    list_push_back(list, E::data(value));
+  }
+  return list;
+}
+
+// Sizes from 10 to 10M elements.
+inline void list_bench_sizes(benchmark::internal::Benchmark * b) {
+  b->RangeMultiplier(10)->Range(10, 10000000);
+}
+
+#endif /* __BENCH_TYPES_HPP__ */
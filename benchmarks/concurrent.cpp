@@ -0,0 +1,177 @@
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include "BenchTypes.hpp"
+
+extern "C" {
+#include "list.h"
+}
+
+// producers push at the back and consumers pop at the front of a shared
+// list: a concurrent list, a lock-free queue, or a plain list guarded by a
+// single mutex.
+static List shared_list;
+static ListQueue shared_queue;
+static std::mutex shared_mutex;
+
+static void BM_concurrent_push_pop(benchmark::State& state) {
+  if (state.thread_index() == 0) {
+    shared_list = list_create_concurrent(int_copy, int_free, int_compare);
+    for (int i = 0; i < 1000; ++i) {
+      list_push_back(shared_list, &i);
+    }
+  }
+
+  int value = state.thread_index();
+  for (auto _ : state) {
+    list_push_back(shared_list, &value);
+    int_free(list_pop_front(shared_list));
+  }
+  state.SetItemsProcessed(state.iterations());
+
+  if (state.thread_index() == 0) {
+    list_destroy(shared_list);
+  }
+}
+BENCHMARK(BM_concurrent_push_pop)->ThreadRange(1, 16)->UseRealTime();
+
+static void BM_queue_push_pop(benchmark::State& state) {
+  if (state.thread_index() == 0) {
+    shared_queue = list_queue_create(int_copy, int_free);
+    for (int i = 0; i < 1000; ++i) {
+      list_queue_push(shared_queue, &i);
+    }
+  }
+
+  int value = state.thread_index();
+  for (auto _ : state) {
+    list_queue_push(shared_queue, &value);
+    int_free(list_queue_pop(shared_queue));
+  }
+  state.SetItemsProcessed(state.iterations());
+
+  if (state.thread_index() == 0) {
+    list_queue_destroy(shared_queue);
+  }
+}
+BENCHMARK(BM_queue_push_pop)->ThreadRange(1, 16)->UseRealTime();
+
+static void BM_mutex_push_pop(benchmark::State& state) {
+  if (state.thread_index() == 0) {
+    shared_list = list_create(int_copy, int_free, int_compare);
+    for (int i = 0; i < 1000; ++i) {
+      list_push_back(shared_list, &i);
+    }
+  }
+
+  int value = state.thread_index();
+  for (auto _ : state) {
+    ListData* data;
+    {
+      std::lock_guard<std::mutex> lock(shared_mutex);
+      list_push_back(shared_list, &value);
+      data = list_pop_front(shared_list);
+    }
+    int_free(data);
+  }
+  state.SetItemsProcessed(state.iterations());
+
+  if (state.thread_index() == 0) {
+    list_destroy(shared_list);
+  }
+}
+BENCHMARK(BM_mutex_push_pop)->ThreadRange(1, 16)->UseRealTime();
+
+// readers traverse a shared list while a writer thread churns through it:
+// an RCU list, or a plain list guarded by a readers-writer lock.
+static std::shared_mutex shared_rwlock;
+static std::atomic<bool> churning;
+static std::atomic<int> registered;
+static std::thread writer;
+
+static long sum_list(List list) {
+  long sum = 0;
+  LIST_FOREACH_FORWARD(int*, i, list) {
+    sum += *i;
+  }
+  return sum;
+}
+
+static void churn(List list, bool locked) {
+  for (int value = 0; churning; ++value) {
+    if (locked) {
+      std::unique_lock<std::shared_mutex> lock(shared_rwlock);
+      list_push_back(list, &value);
+      list_remove_at(list, 0);
+    } else {
+      list_push_back(list, &value);
+      list_remove_at(list, 0);
+    }
+  }
+}
+
+static void start_churn(List list, bool locked) {
+  for (int i = 0; i < 1000; ++i) {
+    list_push_back(list, &i);
+  }
+  churning = true;
+  writer = std::thread(churn, list, locked);
+}
+
+static void stop_churn() {
+  churning = false;
+  writer.join();
+  list_destroy(shared_list);
+}
+
+static void BM_rcu_readers(benchmark::State& state) {
+  if (state.thread_index() == 0) {
+    shared_list = list_create_rcu(int_copy, int_free, int_compare);
+    start_churn(shared_list, false);
+  }
+
+  ListReader reader = nullptr;
+  for (auto _ : state) {
+    // the list exists once all the threads are in the loop.
+    if (reader == nullptr) {
+      reader = list_rcu_register(shared_list);
+      ++registered;
+    }
+    list_rcu_read_lock(reader);
+    benchmark::DoNotOptimize(sum_list(shared_list));
+    list_rcu_read_unlock(reader);
+  }
+  state.SetItemsProcessed(state.iterations() * 1000);
+
+  if (reader != nullptr) {
+    list_rcu_unregister(reader);
+    --registered;
+  }
+  if (state.thread_index() == 0) {
+    while (registered != 0) {
+      std::this_thread::yield();
+    }
+    stop_churn();
+  }
+}
+BENCHMARK(BM_rcu_readers)->ThreadRange(1, 16)->UseRealTime();
+
+static void BM_rwlock_readers(benchmark::State& state) {
+  if (state.thread_index() == 0) {
+    shared_list = list_create(int_copy, int_free, int_compare);
+    start_churn(shared_list, true);
+  }
+
+  for (auto _ : state) {
+    std::shared_lock<std::shared_mutex> lock(shared_rwlock);
+    benchmark::DoNotOptimize(sum_list(shared_list));
+  }
+  state.SetItemsProcessed(state.iterations() * 1000);
+
+  if (state.thread_index() == 0) {
+    stop_churn();
+  }
+}
+BENCHMARK(BM_rwlock_readers)->ThreadRange(1, 16)->UseRealTime();
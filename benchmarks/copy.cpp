@@ -0,0 +1,99 @@
+#include <benchmark/benchmark.h>
+#include <deque>
+#include <list>
+#include "BenchTypes.hpp"
+
+extern "C" {
+#include "list.h"
+}
+
+template <class E>
+static void BM_copy(benchmark::State& state) {
+  List list = make_list<E>(make_values<E>(state.range(0)));
+  for (auto _ : state) {
+    List copy = list_copy(list);
+    state.PauseTiming();
+    list_destroy(copy);
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  list_destroy(list);
+}
+BENCHMARK_TEMPLATE(BM_copy, IntElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_copy, StringElement)->Apply(list_bench_sizes);
+
+// copies which share the nodes, then the first change to the list, which
+// gives it nodes of its own
+template <class E>
+static void BM_copy_cow(benchmark::State& state) {
+  List list = make_list<E>(make_values<E>(state.range(0)));
+  for (auto _ : state) {
+    List copy = list_copy_cow(list);
+    state.PauseTiming();
+    list_destroy(copy);
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  list_destroy(list);
+}
+BENCHMARK_TEMPLATE(BM_copy_cow, IntElement)->Apply(list_bench_sizes);
+
+template <class E>
+static void BM_copy_cow_first_write(benchmark::State& state) {
+  auto values = make_values<E>(state.range(0));
+  List list = make_list<E>(values);
+  for (auto _ : state) {
+    List copy = list_copy_cow(list);
+    list_push_back(list, E::data(values[0]));
+    state.PauseTiming();
+    list_destroy(copy);
+    list_remove_at(list, state.range(0));
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  list_destroy(list);
+}
+BENCHMARK_TEMPLATE(BM_copy_cow_first_write, IntElement)->Apply(list_bench_sizes);
+
+// reports on a list which changes all the time: a point-in-time view per
+// range(1) changes, with list_copy or with list_snapshot
+static void BM_report(benchmark::State& state, List (*view)(const List)) {
+  List list = make_list<IntElement>(make_values<IntElement>(state.range(0)));
+  int value = 0;
+  for (auto _ : state) {
+    List report = view(list);
+    for (int i = 0; i < state.range(1); ++i) {
+      list_push_back(list, &value);
+      list_remove_at(list, 0);
+    }
+    list_destroy(report);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(1));
+  list_destroy(list);
+}
+static void BM_report_copy(benchmark::State& state) {
+  BM_report(state, list_copy);
+}
+static void BM_report_snapshot(benchmark::State& state) {
+  BM_report(state, list_snapshot);
+}
+BENCHMARK(BM_report_copy)->Args({ 100000, 0 })->Args({ 100000, 1 })->Args({ 100000, 100 })->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_report_snapshot)->Args({ 100000, 0 })->Args({ 100000, 1 })->Args({ 100000, 100 })->Unit(benchmark::kMicrosecond);
+
+// baselines
+template <class Container, class E>
+static void BM_std_copy(benchmark::State& state) {
+  auto values = make_values<E>(state.range(0));
+  Container container(values.begin(), values.end());
+  for (auto _ : state) {
+    Container * copy = new Container(container);
+    state.PauseTiming();
+    delete copy;
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_std_copy, std::list<int>, IntElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_std_copy, std::list<std::string>, StringElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_std_copy, std::deque<int>, IntElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_std_copy, std::deque<std::string>, StringElement)->Apply(list_bench_sizes);
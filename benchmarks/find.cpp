@@ -0,0 +1,70 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <list>
+#include "BenchTypes.hpp"
+#include "list.hpp"
+
+extern "C" {
+#include "list.h"
+}
+
+template <class E>
+static void BM_find(benchmark::State& state) {
+  auto values = make_values<E>(state.range(0));
+  List list = make_list<E>(values);
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(list_find(list, E::data(values[i])));
+    i = (i + 7919) % values.size();
+  }
+  list_destroy(list);
+}
+BENCHMARK_TEMPLATE(BM_find, IntElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_find, StringElement)->Apply(list_bench_sizes);
+
+static void BM_find_indexed(benchmark::State& state) {
+  List list = list_create(int_copy, int_free, int_compare);
+  list_set_hash_index(list, int_hash);
+  for (int i = 0; i < state.range(0); ++i) {
+    list_push_back(list, &i);
+  }
+
+  int i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(list_find(list, &i));
+    i = (i + 7919) % state.range(0);
+  }
+  list_destroy(list);
+}
+BENCHMARK(BM_find_indexed)->Apply(list_bench_sizes);
+
+// the C++ wrapper, whose find inlines the comparator
+template <class E>
+static void BM_clist_find(benchmark::State& state) {
+  auto values = make_values<E>(state.range(0));
+  clist::list<typename E::value_type> list;
+  for (const auto & value : values) {
+    list.push_back(value);
+  }
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(list.find(values[i]));
+    i = (i + 7919) % values.size();
+  }
+}
+BENCHMARK_TEMPLATE(BM_clist_find, IntElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_clist_find, StringElement)->Apply(list_bench_sizes);
+
+// baseline
+template <class E>
+static void BM_std_find(benchmark::State& state) {
+  auto values = make_values<E>(state.range(0));
+  std::list<typename E::value_type> container(values.begin(), values.end());
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(std::find(container.begin(), container.end(), values[i]));
+    i = (i + 7919) % values.size();
+  }
+}
+BENCHMARK_TEMPLATE(BM_std_find, IntElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_std_find, StringElement)->Apply(list_bench_sizes);
@@ -0,0 +1,152 @@
+#include <benchmark/benchmark.h>
+#include <deque>
+#include <iterator>
+#include <list>
+#include "BenchTypes.hpp"
+
+extern "C" {
+#include "list.h"
+}
+
+// positions spread over the whole list, so walks from both ends are measured
+static size_t next_position(size_t i, size_t size) {
+  return (i + 7919) % size;
+}
+
+template <class E>
+static void BM_get_at(benchmark::State& state) {
+  List list = make_list<E>(make_values<E>(state.range(0)));
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(list_get_at(list, i));
+    i = next_position(i, state.range(0));
+  }
+  list_destroy(list);
+}
+BENCHMARK_TEMPLATE(BM_get_at, IntElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_get_at, StringElement)->Apply(list_bench_sizes);
+
+// pushes an element and removes it again, to keep the size of the list fixed
+template <class E>
+static void BM_push_at(benchmark::State& state) {
+  auto values = make_values<E>(state.range(0));
+  List list = make_list<E>(values);
+  size_t i = 0;
+  for (auto _ : state) {
+    list_push_at(list, i, E::data(values[i]));
+    E::destroy(list_remove_at_take(list, i));
+    i = next_position(i, state.range(0));
+  }
+  list_destroy(list);
+}
+BENCHMARK_TEMPLATE(BM_push_at, IntElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_push_at, StringElement)->Apply(list_bench_sizes);
+
+// moves the back half of a list to another and back, by relinking the nodes
+// or by popping and pushing every element
+template <class E>
+static void BM_split_concat(benchmark::State& state) {
+  List list = make_list<E>(make_values<E>(state.range(0)));
+  for (auto _ : state) {
+    ListIteratorStorage storage;
+    ListIterator middle = list_iterator_init(&storage, list);
+    for (long i = 0; i < state.range(0) / 2; ++i) {
+      list_iterator_next(middle);
+    }
+    List back = list_split_at(list, middle);
+    list_concat(list, back);
+    list_destroy(back);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) / 2);
+  list_destroy(list);
+}
+BENCHMARK_TEMPLATE(BM_split_concat, IntElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_split_concat, StringElement)->Apply(list_bench_sizes);
+
+template <class E>
+static void BM_pop_push_half(benchmark::State& state) {
+  List list = make_list<E>(make_values<E>(state.range(0)));
+  List back = E::create();
+  for (auto _ : state) {
+    for (long i = 0; i < state.range(0) / 2; ++i) {
+      ListData* data = list_pop_back(list);
+      list_push_front(back, data);
+      E::destroy(data);
+    }
+    for (long i = 0; i < state.range(0) / 2; ++i) {
+      ListData* data = list_pop_front(back);
+      list_push_back(list, data);
+      E::destroy(data);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) / 2);
+  list_destroy(back);
+  list_destroy(list);
+}
+BENCHMARK_TEMPLATE(BM_pop_push_half, IntElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_pop_push_half, StringElement)->Apply(list_bench_sizes);
+
+// removes a value which is every 4th element of the list, in one pass or
+// with one list_remove per element, which walks from the front every time
+static void BM_remove_all(benchmark::State& state, bool one_pass) {
+  typedef IntElement E;
+  auto values = make_values<E>(state.range(0));
+  for (size_t i = 0; i < values.size(); i += 4) {
+    values[i] = values[0];
+  }
+  for (auto _ : state) {
+    state.PauseTiming();
+    List list = make_list<E>(values);
+    state.ResumeTiming();
+    if (one_pass) {
+      benchmark::DoNotOptimize(list_remove_all(list, E::data(values[0])));
+    } else {
+      while (list_remove(list, E::data(values[0])) == LIST_SUCCESS) {
+      }
+    }
+    state.PauseTiming();
+    list_destroy(list);
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+static void BM_remove_all_one_pass(benchmark::State& state) {
+  BM_remove_all(state, true);
+}
+static void BM_remove_all_loop(benchmark::State& state) {
+  BM_remove_all(state, false);
+}
+BENCHMARK(BM_remove_all_one_pass)->Range(10, 1000000);
+BENCHMARK(BM_remove_all_loop)->Range(10, 32768);
+
+// baselines
+template <class Container, class E>
+static void BM_std_get_at(benchmark::State& state) {
+  auto values = make_values<E>(state.range(0));
+  Container container(values.begin(), values.end());
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(*std::next(container.begin(), i));
+    i = next_position(i, state.range(0));
+  }
+}
+BENCHMARK_TEMPLATE(BM_std_get_at, std::list<int>, IntElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_std_get_at, std::list<std::string>, StringElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_std_get_at, std::deque<int>, IntElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_std_get_at, std::deque<std::string>, StringElement)->Apply(list_bench_sizes);
+
+template <class Container, class E>
+static void BM_std_push_at(benchmark::State& state) {
+  auto values = make_values<E>(state.range(0));
+  Container container(values.begin(), values.end());
+  size_t i = 0;
+  for (auto _ : state) {
+    auto it = container.insert(std::next(container.begin(), i), values[i]);
+    container.erase(it);
+    i = next_position(i, state.range(0));
+  }
+}
+BENCHMARK_TEMPLATE(BM_std_push_at, std::list<int>, IntElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_std_push_at, std::list<std::string>, StringElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_std_push_at, std::deque<int>, IntElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_std_push_at, std::deque<std::string>, StringElement)->Apply(list_bench_sizes);
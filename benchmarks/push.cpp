@@ -0,0 +1,257 @@
+#include <benchmark/benchmark.h>
+#include <deque>
+#include <list>
+#include <vector>
+#include "BenchTypes.hpp"
+
+extern "C" {
+#include "list.h"
+}
+
+template <class E>
+static void BM_push_back(benchmark::State& state) {
+  auto values = make_values<E>(state.range(0));
+  for (auto _ : state) {
+    List list = E::create();
+    for (const auto & value : values) {
+      list_push_back(list, E::data(value));
+    }
+    state.PauseTiming();
+    list_destroy(list);
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_push_back, IntElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_push_back, StringElement)->Apply(list_bench_sizes);
+
+template <class E>
+static void BM_push_front(benchmark::State& state) {
+  auto values = make_values<E>(state.range(0));
+  for (auto _ : state) {
+    List list = E::create();
+    for (const auto & value : values) {
+      list_push_front(list, E::data(value));
+    }
+    state.PauseTiming();
+    list_destroy(list);
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_push_front, IntElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_push_front, StringElement)->Apply(list_bench_sizes);
+
+static void BM_push_back_slab(benchmark::State& state) {
+  for (auto _ : state) {
+    List list = list_create_with_allocator(int_copy, int_free, int_compare, list_slab_allocator());
+    for (int i = 0; i < state.range(0); ++i) {
+      list_push_back(list, &i);
+    }
+    state.PauseTiming();
+    list_destroy(list);
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_push_back_slab)->Apply(list_bench_sizes);
+
+// the same elements pushed at once, next to BM_push_back and BM_push_back_slab
+template <class E>
+static void BM_push_back_array(benchmark::State& state) {
+  auto values = make_values<E>(state.range(0));
+  std::vector<ListData*> pointers;
+  for (const auto & value : values) {
+    pointers.push_back(const_cast<ListData*>(E::data(value)));
+  }
+  for (auto _ : state) {
+    List list = E::create();
+    list_push_back_array(list, pointers.data(), pointers.size(), false);
+    state.PauseTiming();
+    list_destroy(list);
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_push_back_array, IntElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_push_back_array, StringElement)->Apply(list_bench_sizes);
+
+static void BM_push_back_array_slab(benchmark::State& state) {
+  std::vector<int> values(state.range(0));
+  std::vector<ListData*> pointers;
+  for (int i = 0; i < state.range(0); ++i) {
+    values[i] = i;
+    pointers.push_back(&values[i]);
+  }
+  for (auto _ : state) {
+    List list = list_create_from_array(int_copy, int_free, int_compare, list_slab_allocator(),
+                                       pointers.data(), pointers.size(), false);
+    state.PauseTiming();
+    list_destroy(list);
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_push_back_array_slab)->Apply(list_bench_sizes);
+
+// exporting the elements to sort them with qsort
+static int compare_pointed_ints(const void * a, const void * b) {
+  return int_compare(*(ListData* const*)a, *(ListData* const*)b);
+}
+
+static void BM_to_array_qsort(benchmark::State& state) {
+  List list = make_list<IntElement>(make_values<IntElement>(state.range(0)));
+  std::vector<ListData*> out(list_get_size(list));
+  for (auto _ : state) {
+    list_to_array(list, out.data(), out.size());
+    qsort(out.data(), out.size(), sizeof(ListData*), compare_pointed_ints);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  list_destroy(list);
+}
+BENCHMARK(BM_to_array_qsort)->Apply(list_bench_sizes)->Unit(benchmark::kMillisecond);
+
+template <class E>
+static void BM_pop_front(benchmark::State& state) {
+  auto values = make_values<E>(state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+    List list = make_list<E>(values);
+    state.ResumeTiming();
+    while (!list_empty(list)) {
+      E::destroy(list_pop_front(list));
+    }
+    state.PauseTiming();
+    list_destroy(list);
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_pop_front, IntElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_pop_front, StringElement)->Apply(list_bench_sizes);
+
+template <class E>
+static void BM_pop_back(benchmark::State& state) {
+  auto values = make_values<E>(state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+    List list = make_list<E>(values);
+    state.ResumeTiming();
+    while (!list_empty(list)) {
+      E::destroy(list_pop_back(list));
+    }
+    state.PauseTiming();
+    list_destroy(list);
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_pop_back, IntElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_pop_back, StringElement)->Apply(list_bench_sizes);
+
+// the time the calling thread spends clearing a list, freeing it right away
+// or handing it to a reclaimer thread
+template <class E>
+static void BM_clear(benchmark::State& state, ListReclaimer reclaimer) {
+  auto values = make_values<E>(state.range(0));
+  List list = E::create();
+  for (auto _ : state) {
+    state.PauseTiming();
+    for (const auto & value : values) {
+      list_push_back(list, E::data(value));
+    }
+    state.ResumeTiming();
+    list_clear_async(list, reclaimer);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  list_destroy(list);
+}
+template <class E>
+static void BM_clear_sync(benchmark::State& state) {
+  BM_clear<E>(state, nullptr);
+}
+template <class E>
+static void BM_clear_async(benchmark::State& state) {
+  ListReclaimer reclaimer = list_reclaimer_create(true);
+  BM_clear<E>(state, reclaimer);
+  list_reclaimer_destroy(reclaimer);
+}
+BENCHMARK_TEMPLATE(BM_clear_sync, IntElement)->Range(1000, 1000000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_clear_sync, StringElement)->Range(1000, 1000000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_clear_async, IntElement)->Range(1000, 1000000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_clear_async, StringElement)->Range(1000, 1000000)->Unit(benchmark::kMicrosecond);
+
+// baselines
+template <class Container, class E>
+static void BM_std_push_back(benchmark::State& state) {
+  auto values = make_values<E>(state.range(0));
+  for (auto _ : state) {
+    Container container;
+    for (const auto & value : values) {
+      container.push_back(value);
+    }
+    state.PauseTiming();
+    container.clear();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_std_push_back, std::list<int>, IntElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_std_push_back, std::list<std::string>, StringElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_std_push_back, std::deque<int>, IntElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_std_push_back, std::deque<std::string>, StringElement)->Apply(list_bench_sizes);
+
+template <class Container, class E>
+static void BM_std_push_front(benchmark::State& state) {
+  auto values = make_values<E>(state.range(0));
+  for (auto _ : state) {
+    Container container;
+    for (const auto & value : values) {
+      container.push_front(value);
+    }
+    state.PauseTiming();
+    container.clear();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_std_push_front, std::list<int>, IntElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_std_push_front, std::list<std::string>, StringElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_std_push_front, std::deque<int>, IntElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_std_push_front, std::deque<std::string>, StringElement)->Apply(list_bench_sizes);
+
+template <class Container, class E>
+static void BM_std_pop_front(benchmark::State& state) {
+  auto values = make_values<E>(state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+    Container container(values.begin(), values.end());
+    state.ResumeTiming();
+    while (!container.empty()) {
+      container.pop_front();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_std_pop_front, std::list<int>, IntElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_std_pop_front, std::list<std::string>, StringElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_std_pop_front, std::deque<int>, IntElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_std_pop_front, std::deque<std::string>, StringElement)->Apply(list_bench_sizes);
+
+template <class Container, class E>
+static void BM_std_pop_back(benchmark::State& state) {
+  auto values = make_values<E>(state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+    Container container(values.begin(), values.end());
+    state.ResumeTiming();
+    while (!container.empty()) {
+      container.pop_back();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_std_pop_back, std::list<int>, IntElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_std_pop_back, std::list<std::string>, StringElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_std_pop_back, std::deque<int>, IntElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_std_pop_back, std::deque<std::string>, StringElement)->Apply(list_bench_sizes);
@@ -0,0 +1,182 @@
+#include <benchmark/benchmark.h>
+#include <list>
+#include <random>
+#include <thread>
+#include "BenchTypes.hpp"
+#include "list.hpp"
+
+extern "C" {
+#include "list.h"
+}
+
+static List random_int_list(int size) {
+  List list = list_create(int_copy, int_free, int_compare);
+  std::mt19937 gen(42);
+  for (int i = 0; i < size; ++i) {
+    int value = gen();
+    list_push_back(list, &value);
+  }
+  return list;
+}
+
+static void BM_sort_parallel(benchmark::State& state) {
+  List list = random_int_list(state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+    List copy = list_copy(list);
+    state.ResumeTiming();
+    list_sort_parallel(copy, state.range(1));
+    state.PauseTiming();
+    list_destroy(copy);
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  list_destroy(list);
+}
+BENCHMARK(BM_sort_parallel)->Apply([](benchmark::internal::Benchmark* b) {
+  unsigned cores = std::thread::hardware_concurrency();
+  for (unsigned threads = 1; threads <= cores; threads *= 2) {
+    b->Args({ 1000000, threads });
+  }
+  if (cores > 1 && (cores & (cores - 1)) != 0) {
+    b->Args({ 1000000, cores });
+  }
+})->Unit(benchmark::kMillisecond)->UseRealTime();
+
+template <class E>
+static void BM_sort(benchmark::State& state) {
+  List list = make_list<E>(make_values<E>(state.range(0)));
+  for (auto _ : state) {
+    state.PauseTiming();
+    List copy = list_copy(list);
+    state.ResumeTiming();
+    list_sort(copy);
+    state.PauseTiming();
+    list_destroy(copy);
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  list_destroy(list);
+}
+BENCHMARK_TEMPLATE(BM_sort, IntElement)->Apply(list_bench_sizes)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_sort, StringElement)->Apply(list_bench_sizes)->Unit(benchmark::kMillisecond);
+
+static uint64_t int_key(const ListData * i) {
+  return (uint64_t)(uint32_t)*(const int*)i ^ 0x80000000u;
+}
+
+static void BM_sort_by_key(benchmark::State& state) {
+  List list = random_int_list(state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+    List copy = list_copy(list);
+    state.ResumeTiming();
+    list_sort_by_key(copy, int_key);
+    state.PauseTiming();
+    list_destroy(copy);
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  list_destroy(list);
+}
+BENCHMARK(BM_sort_by_key)->Apply(list_bench_sizes)->Unit(benchmark::kMillisecond);
+
+// the C++ wrapper, whose sort inlines the comparator
+template <class E>
+static void BM_clist_sort(benchmark::State& state) {
+  auto values = make_values<E>(state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+    clist::list<typename E::value_type> list;
+    for (const auto & value : values) {
+      list.push_back(value);
+    }
+    state.ResumeTiming();
+    list.sort();
+    state.PauseTiming();
+    list.clear();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_clist_sort, IntElement)->Apply(list_bench_sizes)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_clist_sort, StringElement)->Apply(list_bench_sizes)->Unit(benchmark::kMillisecond);
+
+// sorted insertion of ascending runs with a hint, against push_back and sort
+static void BM_insert_sorted(benchmark::State& state) {
+  std::mt19937 gen(42);
+  std::vector<int> values(state.range(0));
+  for (size_t i = 0; i < values.size(); ++i) {
+    values[i] = (i % 64 == 0) ? (int)(gen() % values.size()) : values[i - 1] + 1;
+  }
+  for (auto _ : state) {
+    List list = list_create(int_copy, int_free, int_compare);
+    ListIteratorStorage storage;
+    ListIterator hint = list_iterator_init(&storage, list);
+    for (int value : values) {
+      list_insert_sorted(list, &value, hint);
+    }
+    state.PauseTiming();
+    list_destroy(list);
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_insert_sorted)->Args({ 1000 })->Args({ 10000 })->Unit(benchmark::kMillisecond);
+
+static void BM_push_back_sort(benchmark::State& state) {
+  std::mt19937 gen(42);
+  std::vector<int> values(state.range(0));
+  for (size_t i = 0; i < values.size(); ++i) {
+    values[i] = (i % 64 == 0) ? (int)(gen() % values.size()) : values[i - 1] + 1;
+  }
+  for (auto _ : state) {
+    List list = list_create(int_copy, int_free, int_compare);
+    for (int value : values) {
+      list_push_back(list, &value);
+    }
+    list_sort(list);
+    state.PauseTiming();
+    list_destroy(list);
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_push_back_sort)->Args({ 1000 })->Args({ 10000 })->Unit(benchmark::kMillisecond);
+
+static void BM_merge(benchmark::State& state) {
+  List list = random_int_list(state.range(0));
+  list_sort(list);
+  for (auto _ : state) {
+    state.PauseTiming();
+    List dst = list_copy(list);
+    List src = list_copy(list);
+    state.ResumeTiming();
+    list_merge(dst, src);
+    state.PauseTiming();
+    list_destroy(dst);
+    list_destroy(src);
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) * 2);
+  list_destroy(list);
+}
+BENCHMARK(BM_merge)->Apply(list_bench_sizes)->Unit(benchmark::kMillisecond);
+
+// baseline
+template <class E>
+static void BM_std_sort(benchmark::State& state) {
+  auto values = make_values<E>(state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::list<typename E::value_type> container(values.begin(), values.end());
+    state.ResumeTiming();
+    container.sort();
+    state.PauseTiming();
+    container.clear();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_std_sort, IntElement)->Apply(list_bench_sizes)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_std_sort, StringElement)->Apply(list_bench_sizes)->Unit(benchmark::kMillisecond);
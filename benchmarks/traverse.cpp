@@ -0,0 +1,174 @@
+#include <benchmark/benchmark.h>
+#include <deque>
+#include <list>
+#include "BenchTypes.hpp"
+
+extern "C" {
+#include "list.h"
+}
+
+template <class E>
+static void BM_traverse(benchmark::State& state) {
+  List list = make_list<E>(make_values<E>(state.range(0)));
+  for (auto _ : state) {
+    long sum = 0;
+    LIST_FOREACH_FORWARD(ListData*, data, list) {
+      sum += E::weigh(data);
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  list_destroy(list);
+}
+BENCHMARK_TEMPLATE(BM_traverse, IntElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_traverse, StringElement)->Apply(list_bench_sizes);
+
+template <class E>
+static void BM_traverse_iterator(benchmark::State& state) {
+  List list = make_list<E>(make_values<E>(state.range(0)));
+  ListIterator it = list_iterator_create(list);
+  for (auto _ : state) {
+    long sum = 0;
+    list_iterator_start(it);
+    while (list_iterator_next(it) == LIST_ITERATOR_SUCCESS) {
+      sum += E::weigh(list_iterator_get(it));
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  list_iterator_destroy(it);
+  list_destroy(list);
+}
+BENCHMARK_TEMPLATE(BM_traverse_iterator, IntElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_traverse_iterator, StringElement)->Apply(list_bench_sizes);
+
+// short lived iterators, on the heap or on the stack
+static void BM_iterator_create(benchmark::State& state) {
+  List list = make_list<IntElement>(make_values<IntElement>(10));
+  for (auto _ : state) {
+    ListIterator it = list_iterator_create(list);
+    benchmark::DoNotOptimize(list_iterator_get(it));
+    list_iterator_destroy(it);
+  }
+  list_destroy(list);
+}
+BENCHMARK(BM_iterator_create);
+
+static void BM_iterator_init(benchmark::State& state) {
+  List list = make_list<IntElement>(make_values<IntElement>(10));
+  for (auto _ : state) {
+    ListIteratorStorage storage;
+    ListIterator it = list_iterator_init(&storage, list);
+    benchmark::DoNotOptimize(list_iterator_get(it));
+    list_iterator_destroy(it);
+  }
+  list_destroy(list);
+}
+BENCHMARK(BM_iterator_init);
+
+static void traverse(benchmark::State& state, List list) {
+  for (int i = 0; i < state.range(0); ++i) {
+    list_push_back(list, &i);
+  }
+
+  for (auto _ : state) {
+    long sum = 0;
+    LIST_FOREACH_FORWARD(int*, i, list) {
+      sum += *i;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  list_destroy(list);
+}
+
+static void BM_traverse_slab(benchmark::State& state) {
+  traverse(state, list_create_with_allocator(int_copy, int_free, int_compare, list_slab_allocator()));
+}
+BENCHMARK(BM_traverse_slab)->Apply(list_bench_sizes);
+
+static void BM_traverse_inline(benchmark::State& state) {
+  traverse(state, list_create_inline(sizeof(int), int_compare, list_malloc_allocator()));
+}
+BENCHMARK(BM_traverse_inline)->Apply(list_bench_sizes);
+
+static void BM_traverse_inline_slab(benchmark::State& state) {
+  traverse(state, list_create_inline(sizeof(int), int_compare, list_slab_allocator()));
+}
+BENCHMARK(BM_traverse_inline_slab)->Apply(list_bench_sizes);
+
+// several threads scanning the same list at once
+static List shared_list;
+
+static void BM_traverse_readers(benchmark::State& state) {
+  if (state.thread_index() == 0) {
+    shared_list = make_list<IntElement>(make_values<IntElement>(state.range(0)));
+  }
+
+  for (auto _ : state) {
+    long sum = 0;
+    LIST_FOREACH_FORWARD(int*, i, shared_list) {
+      sum += *i;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+
+  if (state.thread_index() == 0) {
+    list_destroy(shared_list);
+  }
+}
+BENCHMARK(BM_traverse_readers)->Arg(1000)->Arg(1000000)->ThreadRange(1, 16)->UseRealTime();
+
+// nodes of a sorted list of random values are scattered in memory, until the
+// list is compacted.
+static void traverse_sorted(benchmark::State& state, bool compact) {
+  List list = list_create_with_allocator(int_copy, int_free, int_compare, list_slab_allocator());
+  for (int i = 0; i < state.range(0); ++i) {
+    int value = (int)((i * 2654435761u) % state.range(0));
+    list_push_back(list, &value);
+  }
+  list_sort(list);
+  if (compact) {
+    list_compact(list);
+  }
+
+  for (auto _ : state) {
+    long sum = 0;
+    LIST_FOREACH_FORWARD(int*, i, list) {
+      sum += *i;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  list_destroy(list);
+}
+
+static void BM_traverse_sorted(benchmark::State& state) {
+  traverse_sorted(state, false);
+}
+BENCHMARK(BM_traverse_sorted)->Arg(1000000);
+
+static void BM_traverse_sorted_compacted(benchmark::State& state) {
+  traverse_sorted(state, true);
+}
+BENCHMARK(BM_traverse_sorted_compacted)->Arg(1000000);
+
+// baselines
+template <class Container, class E>
+static void BM_std_traverse(benchmark::State& state) {
+  auto values = make_values<E>(state.range(0));
+  Container container(values.begin(), values.end());
+  for (auto _ : state) {
+    long sum = 0;
+    for (const auto & value : container) {
+      sum += E::weigh(value);
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_std_traverse, std::list<int>, IntElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_std_traverse, std::list<std::string>, StringElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_std_traverse, std::deque<int>, IntElement)->Apply(list_bench_sizes);
+BENCHMARK_TEMPLATE(BM_std_traverse, std::deque<std::string>, StringElement)->Apply(list_bench_sizes);
@@ -0,0 +1,73 @@
+#include <benchmark/benchmark.h>
+#include "BenchTypes.hpp"
+
+extern "C" {
+#include "list_typed.h"
+}
+
+LIST_DECLARE(intlist, int)
+
+// lists generated with LIST_DECLARE, next to the generic List of integers
+// in push.cpp, traverse.cpp, find.cpp and sort.cpp.
+static intlist * make_intlist(const std::vector<int> & values) {
+  intlist * list = intlist_create();
+  for (int value : values) {
+    intlist_push_back(list, value);
+  }
+  return list;
+}
+
+static void BM_typed_push_back(benchmark::State& state) {
+  for (auto _ : state) {
+    intlist * list = intlist_create();
+    for (int i = 0; i < state.range(0); ++i) {
+      intlist_push_back(list, i);
+    }
+    state.PauseTiming();
+    intlist_destroy(list);
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_typed_push_back)->Apply(list_bench_sizes);
+
+static void BM_typed_traverse(benchmark::State& state) {
+  intlist * list = make_intlist(make_values<IntElement>(state.range(0)));
+  for (auto _ : state) {
+    long sum = 0;
+    LIST_TYPED_FOREACH(int, value, list) {
+      sum += *value;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  intlist_destroy(list);
+}
+BENCHMARK(BM_typed_traverse)->Apply(list_bench_sizes);
+
+static void BM_typed_find(benchmark::State& state) {
+  auto values = make_values<IntElement>(state.range(0));
+  intlist * list = make_intlist(values);
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(intlist_find(list, values[i]));
+    i = (i + 7919) % values.size();
+  }
+  intlist_destroy(list);
+}
+BENCHMARK(BM_typed_find)->Apply(list_bench_sizes);
+
+static void BM_typed_sort(benchmark::State& state) {
+  auto values = make_values<IntElement>(state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+    intlist * list = make_intlist(values);
+    state.ResumeTiming();
+    intlist_sort(list);
+    state.PauseTiming();
+    intlist_destroy(list);
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_typed_sort)->Apply(list_bench_sizes)->Unit(benchmark::kMillisecond);
@@ -39,6 +39,7 @@ extern "C" {
 
 #include <stdlib.h> // size_t
 #include <stdbool.h>
+#include <stdint.h> // uint64_t
 
   typedef enum {
     LIST_SUCCESS,
@@ -59,11 +60,50 @@ extern "C" {
 
   typedef struct list_iterator_t *ListIterator;
 
+  typedef struct list_queue_t *ListQueue;
+
+  typedef struct list_reader_t *ListReader;
+
+  typedef struct list_reclaimer_t *ListReclaimer;
+
+  /**
+  * Storage for an iterator, to place it on the stack or inside another
+  * struct instead of on the heap. See list_iterator_init. Its content is
+  * private to the list.
+  */
+  typedef struct list_iterator_storage_t {
+    void * opaque[4];
+  } ListIteratorStorage;
+
+  /**
+  * A cursor to traverse a list without allocating anything and without
+  * changing the list, see list_cursor_first. It is meant to live on the
+  * stack; its content is private to the list.
+  *
+  * Any number of cursors, from any number of threads, may traverse the same
+  * list at once, as long as nobody modifies the list meanwhile.
+  */
+  typedef struct list_cursor_t {
+    void * node;
+  } ListCursor;
+
   /**
   * The generic data type the list holds.
   */
   typedef void ListData;
 
+  /**
+  * The layout of the nodes of a list, for traversals inlined into the caller
+  * (see list.hpp). The head of a list is a node whose data is NULL pointer,
+  * and the list is circular through it. Only code which keeps the rest of
+  * the list consistent, like list.hpp for the lists it owns, may relink
+  * nodes; others only read them.
+  */
+  typedef struct list_node_t {
+    ListData * data;
+    struct list_node_t *next, *prev;
+  } ListNode;
+
   /**
   * Pointer to a function to copy the data.
   */
@@ -85,18 +125,73 @@ extern "C" {
   typedef int(*ListCompareFunction)(const ListData*, const ListData*);
 
   /**
-  * for loops to iterate over the list, for user's convenience.
+  * Pointer to a function which extracts a sort key from a data element.
+  *
+  * Keys are compared as unsigned integers, and should agree with the compare
+  * function: if the key of a is less than the key of b, a should be less
+  * than b. Elements with equal keys are ordered by the compare function, so
+  * a key may be just a prefix of the order - e.g. the first 8 characters of
+  * a string packed in big-endian order. Signed integers should have their
+  * sign bit flipped.
+  */
+  typedef uint64_t(*ListKeyFunction)(const ListData*);
+
+  /**
+  * Pointer to a function which hashes a data element. Elements which are
+  * equal by the compare function must have equal hashes.
+  */
+  typedef size_t(*ListHashFunction)(const ListData*);
+
+  /**
+  * Pointer to a function which tells whether a data element matches, given
+  * the context pointer passed along with it.
+  */
+  typedef bool(*ListPredicateFunction)(const ListData*, void*);
+
+  /**
+  * Node allocator used by a list to allocate its nodes.
+  *
+  * @create:   Optional. Called once per list with the size of its nodes and
+  *            @arg. Returns the allocator state passed to the other callbacks,
+  *            or NULL pointer on failure. If NULL, the state is NULL pointer.
+  * @destroy:  Optional. Frees the state when the list is destroyed.
+  * @alloc:    Allocates a single node of @node_size bytes.
+  * @free:     Frees a single node allocated with @alloc.
+  * @release:  Optional. Frees all the nodes allocated from the state at once.
+  *            When present, list_clear and list_destroy use it instead of
+  *            freeing the nodes one by one.
+  * @arg:      User argument passed to @create.
+  */
+  typedef struct list_allocator_t {
+    void * (*create)(size_t node_size, void * arg);
+    void(*destroy)(void * state);
+    void * (*alloc)(void * state, size_t node_size);
+    void(*free)(void * state, void * node);
+    void(*release)(void * state);
+    void * arg;
+  } ListAllocator;
+
+  /**
+  * for loops to iterate over the list, for user's convenience. Each loop has
+  * its own cursor, so loops may be nested and may run in several threads at
+  * once. The list must not be modified inside the loop.
   */
 
 #define LIST_FOREACH_FORWARD(type, variable, list) \
-	for (const type variable = (type)list_get_first(list, 0); \
-			variable != 0; \
-			variable = (type)list_get_next(list, 0))
+	for (ListCursor __cursor_##variable = { 0 }; \
+			__cursor_##variable.node == 0; \
+			__cursor_##variable.node = &__cursor_##variable) \
+		for (const type variable = (type)list_cursor_first(list, &__cursor_##variable); \
+				variable != 0; \
+				variable = (type)list_cursor_next(list, &__cursor_##variable))
 
 #define LIST_FOREACH_BACKWARD(type, variable, list) \
-	for (const type variable = (type)list_get_last(list, 0); \
-			variable != 0; \
-			variable = (type)list_get_prev(list, 0))
+	for (ListCursor __cursor_##variable = { 0 }; \
+			__cursor_##variable.node == 0; \
+			__cursor_##variable.node = &__cursor_##variable) \
+		for (const type variable = (type)list_cursor_last(list, &__cursor_##variable); \
+				variable != 0; \
+				variable = (type)list_cursor_prev(list, &__cursor_##variable))
 
 
   /**
@@ -110,6 +205,126 @@ extern "C" {
   */
   List list_create(ListCopyFunction data_copy, ListFreeFunction data_free, ListCompareFunction data_compare);
 
+  /**
+  * list_create_with_allocator - creates a new list which allocates its nodes
+  *                              with a given allocator.
+  *
+  * @data_copy:	  	Pointer to a copy data function.
+  * @data_free:	  	Pointer to a free data function.
+  * @data_compare:	Pointer to a data compare function.
+  * @allocator:     The node allocator. It is copied, so it does not need to
+  *                 outlive the call.
+  *
+  * return:	Pointer to the new list if it succeeds. NULL pointer otherwise.
+  */
+  List list_create_with_allocator(ListCopyFunction data_copy, ListFreeFunction data_free,
+                                  ListCompareFunction data_compare, const ListAllocator * allocator);
+
+  /**
+  * list_create_inline - creates a new list which stores fixed-size elements
+  *                      inside its nodes instead of pointers to them.
+  *                      Elements are copied in and out with memcpy, so this
+  *                      fits plain data types only. Pointers returned by the
+  *                      element access functions point into the nodes and are
+  *                      valid until the element is removed. Extracted elements
+  *                      (list_pop_front etc.) are heap copies to be free'd
+  *                      with free, and elements passed to *_take functions
+  *                      must be allocated with malloc.
+  *
+  * @elem_size:     The size of every element in bytes.
+  * @data_compare:	Pointer to a data compare function.
+  * @allocator:     The node allocator, e.g. list_malloc_allocator().
+  *
+  * return:	Pointer to the new list if it succeeds. NULL pointer otherwise.
+  */
+  List list_create_inline(size_t elem_size, ListCompareFunction data_compare, const ListAllocator * allocator);
+
+  /**
+  * list_create_concurrent - creates a new list which may be used by several
+  *                          threads at once without external locking.
+  *
+  *                          Pushing and popping at both ends, and pushing and
+  *                          removing through iterators, only lock the nodes
+  *                          around the change, so they run in parallel on
+  *                          disjoint parts of the list. All other operations
+  *                          lock the whole list. A thread must keep the node
+  *                          of its iterator from being removed by others.
+  *                          list_get_next and list_get_prev need an iterator,
+  *                          and cursors (and so LIST_FOREACH_*) may not run
+  *                          while the list is modified. Hash indexes are not
+  *                          supported, and nodes are allocated with malloc.
+  *
+  * @data_copy:	  	Pointer to a thread-safe copy data function.
+  * @data_free:	  	Pointer to a thread-safe free data function.
+  * @data_compare:	Pointer to a data compare function.
+  *
+  * return:	Pointer to the new list if it succeeds. NULL pointer otherwise.
+  */
+  List list_create_concurrent(ListCopyFunction data_copy, ListFreeFunction data_free, ListCompareFunction data_compare);
+
+  /**
+  * list_create_rcu - creates a new list for read-mostly use, which readers
+  *                   traverse without locks while writers change it.
+  *
+  *                   Readers register with list_rcu_register, and traverse
+  *                   the list with cursors, LIST_FOREACH_*, iterators,
+  *                   list_find or list_get_at inside list_rcu_read_lock and
+  *                   list_rcu_read_unlock. Writers push, remove and set
+  *                   elements one at a time. Removed nodes and their data
+  *                   are freed after every reader which might see them left
+  *                   its read-side section, and functions which hand data
+  *                   to the caller wait for that first. Writers may not run
+  *                   inside a read-side section of the same list, and a
+  *                   writer must keep the node of its iterator from being
+  *                   removed by others. Sorting, compacting and hash indexes
+  *                   are not supported, and nodes are allocated with malloc.
+  *
+  * @data_copy:	  	Pointer to a thread-safe copy data function.
+  * @data_free:	  	Pointer to a thread-safe free data function.
+  * @data_compare:	Pointer to a data compare function.
+  *
+  * return:	Pointer to the new list if it succeeds. NULL pointer otherwise.
+  */
+  List list_create_rcu(ListCopyFunction data_copy, ListFreeFunction data_free, ListCompareFunction data_compare);
+
+  /**
+  * list_malloc_allocator - Gets the allocator list_create uses, which
+  *                         allocates every node with malloc.
+  */
+  const ListAllocator * list_malloc_allocator(void);
+
+  /**
+  * list_slab_allocator - Gets the built-in slab allocator. It carves nodes out
+  *                       of large chunks, recycles removed nodes through a free
+  *                       list, and releases all the chunks at once on
+  *                       list_clear and list_destroy.
+  *
+  * return: The slab allocator, to be passed to list_create_with_allocator.
+  */
+  const ListAllocator * list_slab_allocator(void);
+
+  /**
+  * list_create_from_array - creates a new list holding the elements of an
+  *                          array of pointers, in order, like
+  *                          list_create_with_allocator followed by
+  *                          list_push_back_array.
+  *
+  * @data_copy:	  	Pointer to a data copy function.
+  * @data_free:	  	Pointer to a data free function.
+  * @data_compare:	Pointer to a data compare function.
+  * @allocator:     The allocator of the nodes.
+  * @data:          The elements.
+  * @n:             The number of elements.
+  * @take_ownership: Whether the list takes the elements themselves instead
+  *                  of copies, as the list_push_*_take functions do.
+  *
+  * return:	Pointer to the new list if it succeeds. NULL pointer otherwise, in
+  *         which case the elements still belong to the caller.
+  */
+  List list_create_from_array(ListCopyFunction data_copy, ListFreeFunction data_free,
+                              ListCompareFunction data_compare, const ListAllocator * allocator,
+                              ListData * const * data, size_t n, bool take_ownership);
+
   /**
   * list_copy - Makes an exact copy of a given list. Iterator is not initialized.
   *
@@ -120,6 +335,62 @@ extern "C" {
   */
   List list_copy(const List list);
 
+  /**
+  * list_copy_cow - Makes a copy of a list which shares the nodes and elements
+  *                 of the list until one of them changes, which takes constant
+  *                 time. The list and its copies may be used by different
+  *                 threads, e.g. to process a snapshot in the background.
+  *
+  *                 A hash index is shared along with the nodes. Before a
+  *                 list which shares its nodes changes, it gets nodes,
+  *                 copies of the elements and an index of its own, which
+  *                 takes as long as list_copy. If that fails, the change fails as
+  *                 it does on an allocation failure. The iterators passed to
+  *                 the change move to the new nodes, but other iterators of
+  *                 the list must not be used with it anymore, as after
+  *                 list_compact. Elements changed through pointers to them
+  *                 change in every list which shares them.
+  *
+  *                 Concurrent lists, RCU lists and lists whose allocator has
+  *                 a state of its own, like the slab allocator, are copied
+  *                 right away, as list_copy does.
+  *
+  * @list:	The list to copy.
+  *
+  * return:	NULL pointer if there was an allocation failure, or if the list is
+  * 			NULL pointer. Pointer to the copied list otherwise.
+  */
+  List list_copy_cow(const List list);
+
+  /**
+  * list_snapshot - Takes a read-only snapshot of a list, which holds the
+  *                 elements of the list at that point while the list goes on
+  *                 changing. It is read like any list, e.g. with iterators,
+  *                 and released with list_destroy.
+  *
+  *                 The snapshot shares the nodes and elements of the list,
+  *                 as list_copy_cow does, so taking it takes constant time.
+  *                 The first change to the list after one or more snapshots
+  *                 gives the list nodes of its own, which takes as long as
+  *                 list_copy. The snapshots keep the old nodes until the
+  *                 last one is destroyed.
+  *
+  *                 Concurrent lists, RCU lists and lists whose allocator has
+  *                 a state of its own are copied right away, under the locks
+  *                 of their writers. Snapshots of RCU lists may therefore not
+  *                 be taken inside a read-side section of the list.
+  *
+  *                 Functions which change a snapshot fail with LIST_EINVAL,
+  *                 NULL pointer or LIST_ITERATOR_EINVAL, and list_clear
+  *                 leaves it as it is.
+  *
+  * @list:	The list to take a snapshot of.
+  *
+  * return:	NULL pointer if there was an allocation failure, or if the list is
+  * 			NULL pointer. Pointer to the snapshot otherwise.
+  */
+  List list_snapshot(const List list);
+
   /**
   * list_destroy - Frees a list with all its elements. Pretty obvious.
   */
@@ -194,6 +465,41 @@ extern "C" {
   */
   ListStatus list_push_at(List list, size_t n, const ListData * data);
 
+  /**
+  * list_push_front_take, list_push_back_take, list_push_after_take,
+  * list_push_before_take, list_push_at_take - Same as their counterparts
+  * above, except that the list takes ownership of @data instead of copying
+  * it. @data must be freeable with the list's ListFreeFunction.
+  *
+  * return: Same as their counterparts. On failure, the ownership of @data
+  *         stays with the caller.
+  */
+  ListStatus list_push_front_take(List list, ListData * data);
+  ListStatus list_push_back_take(List list, ListData * data);
+  ListStatus list_push_after_take(List list, const ListIterator iterator, ListData * data);
+  ListStatus list_push_before_take(List list, const ListIterator iterator, ListData * data);
+  ListStatus list_push_at_take(List list, size_t n, ListData * data);
+
+  /**
+  * list_push_back_array - Adds the elements of an array of pointers to the
+  *                        end of a list, in order. All the nodes are
+  *                        allocated before any is linked, from a single chunk
+  *                        with the slab allocator, and they are linked in one
+  *                        pass.
+  *
+  * @list:	The list to insert the elements to.
+  * @data:	The elements.
+  * @n:	    The number of elements.
+  * @take_ownership: Whether the list takes the elements themselves instead of
+  *                  copies, as the list_push_*_take functions do.
+  *
+  * return:	LIST_EINVAL if list is NULL pointer, or one of the elements is.
+  * 		  	LIST_NO_MEM if there was an allocation failure, in which case
+  * 		  	the list stays unaffected and the elements belong to the caller.
+  * 		  	LIST_SUCCESS otherwise.
+  */
+  ListStatus list_push_back_array(List list, ListData * const * data, size_t n, bool take_ownership);
+
   /**
   * list_remove - Removes a data element from a list. If the given data exists
   *               in several elements in the list, it will remove he first one
@@ -208,6 +514,21 @@ extern "C" {
   */
   ListStatus list_remove(List list, const ListData* data);
 
+  /**
+  * list_remove_take - Extracts a data element from a list without freeing it.
+  *                    If the given data exists in several elements in the
+  *                    list, it extracts the first one in forward order.
+  *                    NOTE: the caller owns the returned element, and thus
+  *                    should free it with ListFreeFunction.
+  *
+  * @list:	The list to extract the data from.
+  * @data:	The data to extract from the list.
+  *
+  * return:	The extracted element, or NULL pointer if one of the arguments is
+  *         NULL pointer or the given data does not exist in the list.
+  */
+  ListData * list_remove_take(List list, const ListData* data);
+
   /**
   * list_remove_at - Removes a node at a given index, stating from 0.
   *
@@ -219,6 +540,20 @@ extern "C" {
   */
   ListStatus list_remove_at(List list, size_t n);
 
+  /**
+  * list_remove_at_take - Extracts the element at a given index, starting
+  *                       from 0, without freeing it.
+  *                       NOTE: the caller owns the returned element, and thus
+  *                       should free it with ListFreeFunction.
+  *
+  * @list: The list to extract the element from.
+  * @n:    The position of the element to extract.
+  *
+  * return: The extracted element, or NULL pointer if n >= list size or list
+  *         is NULL pointer.
+  */
+  ListData * list_remove_at_take(List list, size_t n);
+
   /**
   * list_pop_front - Extracts the first element from the list.
   *                  NOTE: this element is allocated on the heap,
@@ -256,24 +591,210 @@ extern "C" {
   */
   ListStatus list_remove_iterator(List list, ListIterator iterator);
 
+  /**
+  * list_remove_if - Removes every data element of a list which matches a
+  *                  predicate, in a single pass. On concurrent lists the
+  *                  elements are freed after the locks are released, and
+  *                  on RCU lists after a grace period.
+  *
+  * @list:	The list to remove the elements from.
+  * @pred:	The predicate, which may not use the list.
+  * @ctx:	A pointer passed to the predicate along with every element.
+  *
+  * return:	The number of elements removed. 0 if list or pred are NULL pointer,
+  *         or if the list cannot change.
+  */
+  size_t list_remove_if(List list, ListPredicateFunction pred, void* ctx);
+
+  /**
+  * list_remove_all - Removes every data element of a list which is equal to
+  *                   a given one, as list_remove_if does.
+  *
+  * @list:	The list to remove the elements from.
+  * @data:	The data to remove from the list.
+  *
+  * return:	The number of elements removed. 0 if list or data are NULL pointer,
+  *         or if the list cannot change.
+  */
+  size_t list_remove_all(List list, const ListData* data);
+
+  /**
+  * list_splice - Moves a range of elements from one list to another, or
+  *               within a list, by relinking their nodes, so nothing is
+  *               copied. Nodes move between lists only when both allocate
+  *               them without a state of their own, like the default
+  *               allocator; slab lists splice only within themselves. The
+  *               range is walked, to count it when moving between lists, or
+  *               to check it when moving within a list.
+  *
+  * @dst:      The list to move the elements to.
+  * @position: The elements are moved before it. An iterator on the start edge
+  *            moves them to the front, and NULL pointer to the back.
+  * @src:      The list to move the elements from, which may be @dst.
+  * @first:    The first element to move. It follows the moved element into
+  *            @dst. Other iterators of moved elements stay on them, and
+  *            list_iterator_next() and list_iterator_prev() go on in @dst up
+  *            to its edges, but they are still taken for iterators of @src:
+  *            they may only be read and moved that way, or reset in @src
+  *            with list_iterator_first(), list_iterator_last(),
+  *            list_iterator_start() or list_iterator_end().
+  * @last:     The element after the range, or NULL pointer to move up to the
+  *            end of @src.
+  *
+  * return: LIST_EINVAL if an argument is NULL pointer or belongs to the wrong
+  *         list, @last comes before @first, @position is inside the range
+  *         within a list, either list is concurrent or RCU, the lists hold
+  *         elements of different sizes or free functions, or they are
+  *         different lists whose allocators have a state of their own.
+  *         LIST_NO_MEM if the hash index of @dst could not grow, in which
+  *         case nothing moves.
+  *         LIST_SUCCESS otherwise.
+  */
+  ListStatus list_splice(List dst, const ListIterator position, List src, ListIterator first, const ListIterator last);
+
+  /**
+  * list_concat - Moves all the elements of a list to the back of another, as
+  *               list_splice does, in constant time unless @dst has a
+  *               hash index.
+  *
+  * @dst: The list to move the elements to.
+  * @src: The list to move the elements from, which is left empty.
+  *
+  * return: As list_splice, and LIST_EINVAL if @dst is @src.
+  */
+  ListStatus list_concat(List dst, List src);
+
+  /**
+  * list_split_at - Splits a list in two. The elements from an iterator on
+  *                 move to a new list, as list_splice does, and the iterator
+  *                 follows its element. Lists whose allocator has a state of
+  *                 its own, like the slab allocator, cannot be split, as the
+  *                 new list would have another state.
+  *
+  * @list:     The list to split. It keeps the elements before @iterator.
+  * @iterator: The first element of the new list. An iterator on the start
+  *            edge moves all the elements, and one on the end edge none.
+  *
+  * return: The new list, with the same functions, allocator and hash index,
+  *         or NULL pointer if an argument is NULL pointer, the list is
+  *         concurrent or RCU, its allocator has a state of its own, or there
+  *         was an allocation failure.
+  */
+  List list_split_at(List list, ListIterator iterator);
+
   /**
   * list_clear - Clears a list from all of its elements.
   */
   void list_clear(List list);
 
   /**
-  * list_sort - Sorts a list (in an ascending order).
-  *             Done in O(N*log(N)) worst case time complexity and O(N) space
+  * list_sort - Sorts a list (in an ascending order). The sort is stable, and
+  *             is done by relinking the nodes, so no element is copied.
+  *             Done in O(N*log(N)) worst case time complexity and O(1) space
   *             complexity.
   *
   * @list: The list to sort.
   *
-  * return: LIST_FAIL in case of any sort of failure, yet the list is
-  *         guaranteed to stay unaffected.
-  *         LIST_SUCCESS in case of success.
+  * return: LIST_EINVAL if list is NULL pointer or an RCU list.
+  *         LIST_SUCCESS otherwise.
   */
   ListStatus list_sort(List list);
 
+  /**
+  * list_sort_parallel - Sorts a list (in an ascending order) using up to a
+  *                      given number of threads. The list is split into runs
+  *                      which are sorted concurrently, and then merged
+  *                      pairwise, concurrently. The result is identical to
+  *                      list_sort. Lists too small to benefit from threads
+  *                      are sorted with list_sort.
+  *                      NOTE: the compare function is called from several
+  *                      threads at once.
+  *
+  * @list:    The list to sort.
+  * @threads: The maximal number of threads to use, including the calling one.
+  *
+  * return: LIST_EINVAL if list is NULL pointer threads is 0 or
+  *         list is an RCU list.
+  *         LIST_SUCCESS otherwise.
+  */
+  ListStatus list_sort_parallel(List list, unsigned threads);
+
+  /**
+  * list_sort_by_key - Sorts a list (in an ascending order) by keys extracted
+  *                    once per element, using an LSD radix sort. The compare
+  *                    function is called only to order elements with equal
+  *                    keys. The sort is stable, and is done by relinking the
+  *                    nodes, so no element is copied. Done in O(N) time
+  *                    complexity (plus sorting the ties) and O(N) space
+  *                    complexity.
+  *
+  * @list: The list to sort.
+  * @key:  The key extraction function.
+  *
+  * return: LIST_EINVAL if one of the arguments is NULL pointer or
+  *         list is an RCU list.
+  *         LIST_NO_MEM if there was an allocation failure, in which case the
+  *         list stays unaffected.
+  *         LIST_SUCCESS otherwise.
+  */
+  ListStatus list_sort_by_key(List list, ListKeyFunction key);
+
+  /**
+  * list_merge - Merges a sorted list into another sorted list, in linear
+  *              time. The elements move without being copied, as
+  *              list_splice moves them, and the merged list is sorted with
+  *              the compare function of @dst. The merge is stable, and of
+  *              equal elements those of @dst come first.
+  *
+  * @dst: The sorted list to merge into.
+  * @src: The sorted list to merge, which is left empty.
+  *
+  * return: LIST_EINVAL if one of the lists is NULL pointer, they are the same
+  *         list, either is concurrent or RCU, they hold elements of
+  *         different sizes or free functions, or their allocators have a
+  *         state of their own.
+  *         LIST_NO_MEM if the hash index of @dst could not grow, in which
+  *         case nothing moves.
+  *         LIST_SUCCESS otherwise.
+  */
+  ListStatus list_merge(List dst, List src);
+
+  /**
+  * list_insert_sorted - Inserts a copy of a data element into a sorted list,
+  *                      after the elements equal to it.
+  *
+  * @list: The sorted list.
+  * @data: The data element to insert.
+  * @hint: An iterator of the list where the search for the position starts,
+  *        or NULL pointer to search from the front. It is set to the new
+  *        element, so inserting close elements one after another takes
+  *        about constant time each.
+  *
+  * return: LIST_EINVAL if list or data are NULL pointer, or @hint belongs to
+  *         another list.
+  *         LIST_NO_MEM if there was an allocation failure.
+  *         LIST_SUCCESS otherwise.
+  */
+  ListStatus list_insert_sorted(List list, const ListData* data, ListIterator hint);
+
+  /**
+  * list_compact - Reallocates the nodes of a list in list order, so that with
+  *                a chunked allocator such as the slab allocator consecutive
+  *                elements are stored consecutively in memory, and traversal
+  *                walks memory sequentially. Useful after sorting or many
+  *                insertions and removals in the middle of the list.
+  *                NOTE: this invalidates all the iterators of the list, as
+  *                well as element pointers of inline lists.
+  *
+  * @list: The list to compact.
+  *
+  * return: LIST_EINVAL if list is NULL pointer or an RCU list.
+  *         LIST_NO_MEM if there was an allocation failure, in which case the
+  *         list stays unaffected.
+  *         LIST_SUCCESS otherwise.
+  */
+  ListStatus list_compact(List list);
+
 
 
   /**                         Element access                                **/
@@ -290,6 +811,10 @@ extern "C" {
   * 			  list. NULL pointer otherwise.
   *         Also, as noted, if iterator is not NULL, sets @iterator to point
   *         to the first element, or NULL if the list is empty.
+  *
+  * NOTE: without an iterator, the position is kept in the list itself for
+  *       list_get_next, so such calls are not reentrant. Use an iterator or
+  *       a ListCursor to traverse a list from several places at once.
   */
   ListData * list_get_first(const List list, ListIterator iterator);
 
@@ -334,6 +859,64 @@ extern "C" {
   */
   ListData * list_get_prev(const List list, ListIterator iterator);
 
+  /**
+  * list_cursor_first - Gets the first data element in a list and sets a
+  *                     cursor to it.
+  *
+  * @list:    The list.
+  * @cursor:  The cursor to set.
+  *
+  * return: The first data element in the list, or NULL pointer if the list
+  *         is empty or one of the arguments is NULL pointer.
+  */
+  ListData * list_cursor_first(const List list, ListCursor * cursor);
+
+  /**
+  * list_cursor_last - Gets the last data element in a list and sets a cursor
+  *                    to it.
+  *
+  * @list:    The list.
+  * @cursor:  The cursor to set.
+  *
+  * return: The last data element in the list, or NULL pointer if the list is
+  *         empty or one of the arguments is NULL pointer.
+  */
+  ListData * list_cursor_last(const List list, ListCursor * cursor);
+
+  /**
+  * list_cursor_next - Advances a cursor to the next data element in a list.
+  *
+  * @list:    The list the cursor was set on.
+  * @cursor:  A cursor set by list_cursor_first or list_cursor_last.
+  *
+  * return: The next data element, or NULL pointer if the cursor passed the
+  *         end of the list. Once it did, the cursor stays there until it is
+  *         set again.
+  */
+  ListData * list_cursor_next(const List list, ListCursor * cursor);
+
+  /**
+  * list_cursor_prev - Moves a cursor to the previous data element in a list.
+  *
+  * @list:    The list the cursor was set on.
+  * @cursor:  A cursor set by list_cursor_first or list_cursor_last.
+  *
+  * return: The previous data element, or NULL pointer if the cursor passed
+  *         the start of the list. Once it did, the cursor stays there until
+  *         it is set again.
+  */
+  ListData * list_cursor_prev(const List list, ListCursor * cursor);
+
+  /**
+  * list_head - Gets the head node of a list, where traversals of its nodes
+  *             start and end. See ListNode.
+  *
+  * @list: The list.
+  *
+  * return: The head node, or NULL pointer if @list is NULL pointer.
+  */
+  ListNode * list_head(const List list);
+
   /**
   * list_get_at - Gets the data element in a list at a given index,
   *               starting from 0.
@@ -357,6 +940,40 @@ extern "C" {
   */
   ListData const * list_find(const List list, const ListData * data);
 
+  /**
+  * list_to_array - Gets pointers to the elements of a list, in order, without
+  *                 copying them. They stay valid until the elements are
+  *                 removed, and on inline lists point into the nodes.
+  *
+  * @list:	The list.
+  * @out:	  An array of at least @n pointers to fill.
+  * @n:	    The number of pointers to get at most, e.g. list_get_size.
+  *
+  * return:	The number of pointers written to @out.
+  */
+  size_t list_to_array(const List list, ListData ** out, size_t n);
+
+  /**
+  * list_set_hash_index - Attaches a hash index to a list, which maps elements
+  *                       to their nodes. The index is kept up to date by all
+  *                       the list operations, and makes list_find,
+  *                       list_remove and list_remove_take O(1) on average.
+  *                       If several elements are equal, list_remove still
+  *                       scans for the first one in forward order.
+  *                       Copies of the list get an index as well.
+  *
+  * @list: The list.
+  * @hash: The hash function of the elements, or NULL pointer to remove the
+  *        index.
+  *
+  * return: LIST_EINVAL if list is NULL pointer,
+  *         a concurrent list or an RCU list.
+  *         LIST_NO_MEM if there was an allocation failure, in which case the
+  *         list is left without an index.
+  *         LIST_SUCCESS otherwise.
+  */
+  ListStatus list_set_hash_index(List list, ListHashFunction hash);
+
 
 
   /**                            Capacity                                   **/
@@ -387,6 +1004,21 @@ extern "C" {
   */
   ListIterator list_iterator_create(const List list);
 
+  /**
+  * list_iterator_init - Initializes an iterator in a given storage, pointing
+  *                      to the first element. Nothing is allocated.
+  *
+  * @storage: Storage for the iterator, which must outlive it.
+  * @list:    The list the iterator will belong to.
+  *
+  * return: The iterator, which lives in @storage, or NULL pointer if one of
+  *         the arguments is NULL pointer.
+  *
+  * NOTE: calling list_iterator_destroy on such an iterator is allowed, and
+  *       does nothing.
+  */
+  ListIterator list_iterator_init(ListIteratorStorage * storage, const List list);
+
   /**
   * list_iterator_copy - Creates a copy of a given iterator.
   *
@@ -396,6 +1028,18 @@ extern "C" {
   */
   ListIterator list_iterator_copy(const ListIterator iterator);
 
+  /**
+  * list_iterator_init_copy - Initializes a copy of a given iterator in a
+  *                           given storage. Nothing is allocated.
+  *
+  * @storage:  Storage for the copy, which must outlive it.
+  * @iterator: The iterator to copy.
+  *
+  * return: The copy of @iterator, which lives in @storage, or NULL pointer if
+  *         one of the arguments is NULL pointer.
+  */
+  ListIterator list_iterator_init_copy(ListIteratorStorage * storage, const ListIterator iterator);
+
   /**
   * list_iterator_first - Sets a given iterator to point to the first node.
   *
@@ -476,18 +1120,34 @@ extern "C" {
   * @iterator: An iterator to the node to set the new value.
   * @val:      The new value to set.
   *
-  * return: LIST_ITERATOR_EINVAL if iterator is NULL pointer,
+  * return: LIST_ITERATOR_EINVAL if one of the arguments is NULL pointer or the
+  *         iterator points to start/end of list,
   *         LIST_ITERATOR_NO_MEM in case of allocation failure,
   *         LIST_ITERATOR_SUCCESS in case of success.
   */
   ListIteratorStatus list_iterator_set(ListIterator iterator, const ListData * val);
 
+  /**
+  * list_iterator_set_take - Sets a new value to a node through an iterator.
+  *                          The list takes ownership of @val instead of
+  *                          copying it, and frees the old value.
+  *
+  * @iterator: An iterator to the node to set the new value.
+  * @val:      The new value to set.
+  *
+  * return: LIST_ITERATOR_EINVAL if one of the arguments is NULL pointer or the
+  *         iterator points to start/end of list,
+  *         LIST_ITERATOR_SUCCESS in case of success.
+  */
+  ListIteratorStatus list_iterator_set_take(ListIterator iterator, ListData * val);
+
   /**
   * list_iterator_destroy - Destroys a given iterator.
   *
   * NOTE: this function needs to be called on ANY iterator created with
-  *       list_iterator_create. i.e., even if the iterator reached to
-  *       end/start of the list or no longer has valid data.
+  *       list_iterator_create or list_iterator_copy. i.e., even if the
+  *       iterator reached to end/start of the list or no longer has valid
+  *       data. Iterators placed in a ListIteratorStorage are left as is.
   */
   void list_iterator_destroy(ListIterator iterator);
 
@@ -501,6 +1161,182 @@ extern "C" {
   */
   bool list_iterator_equal(const ListIterator first, const ListIterator second);
 
+  /**                            RCU readers                                **/
+
+  /**
+  * list_rcu_register - Registers the calling thread as a reader of an RCU
+  *                     list. Every reader thread has its own handle.
+  *
+  * @list: An RCU list.
+  *
+  * return: The reader, or NULL pointer if @list is not an RCU list or there
+  *         was an allocation failure.
+  */
+  ListReader list_rcu_register(const List list);
+
+  /**
+  * list_rcu_unregister - Unregisters and frees a reader, outside of its
+  *                       read-side sections. Readers are unregistered before
+  *                       their list is destroyed.
+  *
+  * @reader: The reader.
+  */
+  void list_rcu_unregister(ListReader reader);
+
+  /**
+  * list_rcu_read_lock - Starts a read-side section, in which the nodes of the
+  *                      list the reader sees are not freed. Sections may nest,
+  *                      and should be short, since writers which free nodes
+  *                      wait for them.
+  *
+  * @reader: The reader.
+  */
+  void list_rcu_read_lock(ListReader reader);
+
+  /**
+  * list_rcu_read_unlock - Ends a read-side section. Nodes and data read in it
+  *                        may not be used after.
+  *
+  * @reader: The reader.
+  */
+  void list_rcu_read_unlock(ListReader reader);
+
+  /**
+  * list_rcu_synchronize - Waits for the readers and frees the nodes removed
+  *                        from an RCU list so far, which are otherwise freed
+  *                        in batches.
+  *
+  * @list: An RCU list.
+  *
+  * return: LIST_EINVAL if @list is NULL pointer or not an RCU list,
+  *         LIST_SUCCESS otherwise.
+  */
+  ListStatus list_rcu_synchronize(List list);
+
+  /**                              queues                                   **/
+
+  /**
+  * list_queue_create - creates a new lock-free FIFO queue, for any number of
+  *                     producer and consumer threads. It pushes at the back
+  *                     and pops at the front like list_push_back and
+  *                     list_pop_front, with the same ownership rules.
+  *
+  * @data_copy:	  	Pointer to a thread-safe copy data function.
+  * @data_free:	  	Pointer to a thread-safe free data function.
+  *
+  * return:	Pointer to the new queue if it succeeds. NULL pointer otherwise.
+  */
+  ListQueue list_queue_create(ListCopyFunction data_copy, ListFreeFunction data_free);
+
+  /**
+  * list_queue_destroy - Frees a queue and the elements left in it. No other
+  *                      thread may use the queue meanwhile.
+  *
+  * @queue: The queue to destroy.
+  */
+  void list_queue_destroy(ListQueue queue);
+
+  /**
+  * list_queue_push - Pushes a copy of a data element at the back of a queue.
+  *
+  * @queue: The queue.
+  * @data:  The data element to push.
+  *
+  * return: LIST_EINVAL if one of the arguments is NULL pointer,
+  *         LIST_NO_MEM if there was an allocation failure,
+  *         LIST_SUCCESS otherwise.
+  */
+  ListStatus list_queue_push(ListQueue queue, const ListData * data);
+
+  /**
+  * list_queue_push_take - Pushes a data element at the back of a queue,
+  *                        which takes ownership of it instead of copying it.
+  *
+  * return: As list_queue_push. On failure, @data still belongs to the caller.
+  */
+  ListStatus list_queue_push_take(ListQueue queue, ListData * data);
+
+  /**
+  * list_queue_pop - Pops the data element at the front of a queue. The
+  *                  caller owns the element and should free it.
+  *
+  * @queue: The queue.
+  *
+  * return: The data element, or NULL pointer if the queue is empty or NULL
+  *         pointer.
+  */
+  ListData * list_queue_pop(ListQueue queue);
+
+  /**                        deferred reclamation                           **/
+
+  /**
+  * list_reclaimer_create - Creates a reclaimer, which frees the nodes and
+  *                         elements list_clear_async and list_destroy_async
+  *                         hand it, so that clearing or destroying a long
+  *                         list does not stall the calling thread. Elements
+  *                         are freed with the data_free function of their
+  *                         list, and nodes with its allocator, from the
+  *                         thread which reclaims them.
+  *
+  * @background: Whether the reclaimer frees what it is handed on a thread of
+  *              its own. Otherwise it only frees on list_reclaim_step.
+  *
+  * return: Pointer to the new reclaimer if it succeeds. NULL pointer if there
+  *         was an allocation failure or the thread could not start.
+  */
+  ListReclaimer list_reclaimer_create(bool background);
+
+  /**
+  * list_reclaimer_destroy - Stops the thread of a reclaimer, frees what is
+  *                          left to reclaim on the calling thread, and then
+  *                          the reclaimer itself. No other thread may use it
+  *                          meanwhile.
+  *
+  * @reclaimer: The reclaimer to destroy.
+  */
+  void list_reclaimer_destroy(ListReclaimer reclaimer);
+
+  /**
+  * list_reclaim_step - Frees some of what a reclaimer was handed, oldest
+  *                     first, on the calling thread. Any number of threads
+  *                     may call it at once, besides the reclaimer thread.
+  *
+  * @reclaimer: The reclaimer.
+  * @budget:    The number of nodes to free at most. Nodes which the
+  *             allocator releases at once, along with their inline elements,
+  *             count as freed all together, and may exceed it.
+  *
+  * return: The number of nodes freed, less than @budget once nothing is left.
+  *         0 if @reclaimer is NULL pointer.
+  */
+  size_t list_reclaim_step(ListReclaimer reclaimer, size_t budget);
+
+  /**
+  * list_clear_async - Clears a list from all of its elements in constant time,
+  *                    and hands them to a reclaimer to free. The list is
+  *                    empty and may be used right away. Its allocator state
+  *                    and hash index go to the reclaimer along with the nodes,
+  *                    and the list gets new ones. On RCU lists it waits for
+  *                    the readers first, as list_clear does. Copy-on-write
+  *                    copies keep the nodes they share with the list.
+  *
+  * @list:      The list to clear. Snapshots stay as they are.
+  * @reclaimer: The reclaimer. If it is NULL pointer, or there was an
+  *             allocation failure, the list is cleared as list_clear does.
+  */
+  void list_clear_async(List list, ListReclaimer reclaimer);
+
+  /**
+  * list_destroy_async - Frees a list in constant time, and hands its elements
+  *                      to a reclaimer to free, as list_clear_async does.
+  *
+  * @list:      The list to destroy.
+  * @reclaimer: The reclaimer. If it is NULL pointer, or there was an
+  *             allocation failure, the list is destroyed as list_destroy
+  *             does.
+  */
+  void list_destroy_async(List list, ListReclaimer reclaimer);
+
 #ifdef __cplusplus
 }
 #endif
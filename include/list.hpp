@@ -0,0 +1,508 @@
+#ifndef __LIST_HPP__
+#define __LIST_HPP__
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+extern "C" {
+#include "list.h"
+}
+
+namespace clist {
+
+  /**
+  * A typed list on top of a C List. Traversals, find and sort run in the
+  * header on the node layout of list.h, so the comparator and the element
+  * accesses are inlined instead of called through ListData pointers.
+  * Elements are moved in without data_copy, and elements and nodes are
+  * allocated with @Alloc, e.g. std::pmr::polymorphic_allocator (see
+  * clist::pmr::list).
+  *
+  * handle() gives the underlying List to C code, which may traverse, find,
+  * sort, remove and copy its elements with the list functions. C code pushes
+  * only through the wrapper, since elements carry a header the wrapper adds,
+  * and copies made with list_copy do not outlive the wrapper.
+  *
+  * @T:       The element type.
+  * @Compare: A default constructible strict weak order of the elements,
+  *           which C callbacks construct as well.
+  * @Alloc:   An allocator of T, which is rebound for nodes and elements.
+  */
+  template <typename T, typename Compare = std::less<T>, typename Alloc = std::allocator<T>>
+  class list {
+    static_assert(std::is_default_constructible<Compare>::value,
+                  "the comparator is constructed by the C callbacks");
+    static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned elements are not supported");
+
+    // the unit of allocation, aligned for both nodes and elements.
+    static constexpr std::size_t alignment = alignof(T) > alignof(void*) ? alignof(T) : alignof(void*);
+    struct alignas(alignment) unit {
+      unsigned char bytes[alignment];
+    };
+    using unit_alloc = typename std::allocator_traits<Alloc>::template rebind_alloc<unit>;
+    using unit_traits = std::allocator_traits<unit_alloc>;
+
+    // the allocator lives apart from the wrapper, so that moving the wrapper
+    // keeps the List and the elements pointing at it.
+    struct state {
+      unit_alloc alloc;
+      explicit state(const Alloc & a) : alloc(a) {}
+    };
+
+    // every element is preceded by one unit pointing at the state of its list.
+    static constexpr std::size_t element_units = 1 + (sizeof(T) + alignment - 1) / alignment;
+    static constexpr std::size_t node_units = (sizeof(ListNode) + alignment - 1) / alignment;
+
+    static state * owner(const ListData * data) {
+      return *reinterpret_cast<state * const *>(reinterpret_cast<const unit*>(data) - 1);
+    }
+
+    template <typename... Args>
+    static T * create(state * s, Args &&... args) {
+      unit * block = unit_traits::allocate(s->alloc, element_units);
+      *reinterpret_cast<state**>(block) = s;
+      try {
+        return ::new (static_cast<void*>(block + 1)) T(std::forward<Args>(args)...);
+      } catch (...) {
+        unit_traits::deallocate(s->alloc, block, element_units);
+        throw;
+      }
+    }
+
+    static void destroy(T * element) {
+      state * s = owner(element);
+      element->~T();
+      unit_traits::deallocate(s->alloc, reinterpret_cast<unit*>(element) - 1, element_units);
+    }
+
+    // callbacks of the C list.
+    static ListData * copy_data(const ListData * data) {
+      if constexpr (std::is_copy_constructible<T>::value) {
+        try {
+          return create(owner(data), *static_cast<const T*>(data));
+        } catch (...) {
+          return nullptr;
+        }
+      } else {
+        return nullptr;
+      }
+    }
+
+    static void free_data(ListData * data) {
+      destroy(static_cast<T*>(data));
+    }
+
+    static int compare_data(const ListData * a, const ListData * b) {
+      Compare comp;
+      const T & x = *static_cast<const T*>(a);
+      const T & y = *static_cast<const T*>(b);
+      return comp(x, y) ? -1 : (comp(y, x) ? 1 : 0);
+    }
+
+    static void * create_nodes(std::size_t, void * arg) {
+      return arg;
+    }
+
+    static void * alloc_node(void * s, std::size_t) {
+      try {
+        return unit_traits::allocate(static_cast<state*>(s)->alloc, node_units);
+      } catch (...) {
+        return nullptr;
+      }
+    }
+
+    static void free_node(void * s, void * node) {
+      unit_traits::deallocate(static_cast<state*>(s)->alloc, static_cast<unit*>(node), node_units);
+    }
+
+    template <bool Const>
+    class basic_iterator {
+      friend class list;
+      template <bool> friend class basic_iterator;
+      ListNode * node_;
+      explicit basic_iterator(ListNode * node) : node_(node) {}
+
+    public:
+      using iterator_category = std::bidirectional_iterator_tag;
+      using value_type = T;
+      using difference_type = std::ptrdiff_t;
+      using pointer = std::conditional_t<Const, const T*, T*>;
+      using reference = std::conditional_t<Const, const T&, T&>;
+
+      basic_iterator() : node_(nullptr) {}
+      // iterators convert to const iterators.
+      template <bool C, typename = std::enable_if_t<Const && !C>>
+      basic_iterator(const basic_iterator<C> & other) : node_(other.node_) {}
+
+      reference operator*() const {
+        return *static_cast<pointer>(node_->data);
+      }
+      pointer operator->() const {
+        return static_cast<pointer>(node_->data);
+      }
+      basic_iterator & operator++() {
+        node_ = node_->next;
+        return *this;
+      }
+      basic_iterator operator++(int) {
+        basic_iterator old = *this;
+        node_ = node_->next;
+        return old;
+      }
+      basic_iterator & operator--() {
+        node_ = node_->prev;
+        return *this;
+      }
+      basic_iterator operator--(int) {
+        basic_iterator old = *this;
+        node_ = node_->prev;
+        return old;
+      }
+      friend bool operator==(const basic_iterator & a, const basic_iterator & b) {
+        return a.node_ == b.node_;
+      }
+      friend bool operator!=(const basic_iterator & a, const basic_iterator & b) {
+        return a.node_ != b.node_;
+      }
+    };
+
+    // bottom-up merge sort of a chain of nodes linked through next, as
+    // list_sort does. equal elements keep their order.
+    template <typename C>
+    static ListNode * merge(ListNode * a, ListNode * b, C & comp) {
+      ListNode * merged = nullptr;
+      ListNode ** tail = &merged;
+      while (a != nullptr && b != nullptr) {
+        if (!comp(*static_cast<const T*>(b->data), *static_cast<const T*>(a->data))) {
+          *tail = a;
+          a = a->next;
+        } else {
+          *tail = b;
+          b = b->next;
+        }
+        tail = &(*tail)->next;
+      }
+      *tail = (a != nullptr) ? a : b;
+
+      return merged;
+    }
+
+    template <typename C>
+    static ListNode * sort_chain(ListNode * chain, C & comp) {
+      ListNode * bins[64] = {};
+      std::size_t max_bin = 0;
+      while (chain != nullptr) {
+        ListNode * run = chain;
+        chain = chain->next;
+        run->next = nullptr;
+
+        std::size_t k;
+        for (k = 0; k < 63 && bins[k] != nullptr; ++k) {
+          run = merge(bins[k], run, comp);
+          bins[k] = nullptr;
+        }
+        bins[k] = (bins[k] != nullptr) ? merge(bins[k], run, comp) : run;
+        if (k > max_bin) {
+          max_bin = k;
+        }
+      }
+
+      ListNode * sorted = nullptr;
+      for (std::size_t k = 0; k <= max_bin; ++k) {
+        sorted = merge(bins[k], sorted, comp);
+      }
+
+      return sorted;
+    }
+
+    void push(T * element, bool front) {
+      ListStatus status = front ? list_push_front_take(list_, element) : list_push_back_take(list_, element);
+      if (status != LIST_SUCCESS) {
+        destroy(element);
+        throw std::bad_alloc();
+      }
+    }
+
+    // the first node, or the head of an empty list. a moved-from list has
+    // neither, and its end is NULL pointer as well.
+    ListNode * first() const noexcept {
+      return list_ != nullptr ? list_head(list_)->next : nullptr;
+    }
+
+    List list_;
+    state * state_;
+    Compare comp_;
+
+  public:
+    using value_type = T;
+    using allocator_type = Alloc;
+    using value_compare = Compare;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    explicit list(const Compare & comp, const Alloc & alloc = Alloc())
+      : list_(nullptr), state_(new state(alloc)), comp_(comp) {
+      ListAllocator allocator = { create_nodes, nullptr, alloc_node, free_node, nullptr, state_ };
+      list_ = list_create_with_allocator(copy_data, free_data, compare_data, &allocator);
+      if (list_ == nullptr) {
+        delete state_;
+        throw std::bad_alloc();
+      }
+    }
+
+    list() : list(Compare(), Alloc()) {}
+
+    explicit list(const Alloc & alloc) : list(Compare(), alloc) {}
+
+    list(std::initializer_list<T> values, const Alloc & alloc = Alloc()) : list(Compare(), alloc) {
+      for (const T & value : values) {
+        push_back(value);
+      }
+    }
+
+    list(const list & other)
+      : list(other.comp_, unit_traits::select_on_container_copy_construction(other.state_->alloc)) {
+      for (const T & value : other) {
+        push_back(value);
+      }
+    }
+
+    // the other list is left empty without a C list: handle() gives NULL
+    // pointer, and it may be read, cleared, assigned to, swapped and
+    // destroyed, but not pushed to or copied before being assigned to.
+    list(list && other) noexcept(std::is_nothrow_copy_constructible<Compare>::value)
+      : list_(other.list_), state_(other.state_), comp_(other.comp_) {
+      other.list_ = nullptr;
+      other.state_ = nullptr;
+    }
+
+    list & operator=(const list & other) {
+      if (this == &other) {
+        return *this;
+      }
+      if (list_ == nullptr && other.list_ != nullptr) {
+        list copy(other);
+        swap(copy);
+        return *this;
+      }
+      clear();
+      for (const T & value : other) {
+        push_back(value);
+      }
+      return *this;
+    }
+
+    list & operator=(list && other) {
+      if constexpr (unit_traits::propagate_on_container_move_assignment::value ||
+                    unit_traits::is_always_equal::value) {
+        swap(other);
+      } else if (state_ == nullptr || other.state_ == nullptr || state_->alloc == other.state_->alloc) {
+        swap(other);
+      } else {
+        // elements cannot change allocators, so they are moved one by one.
+        clear();
+        for (T & value : other) {
+          push_back(std::move(value));
+        }
+        other.clear();
+      }
+      return *this;
+    }
+
+    ~list() {
+      // the elements and nodes are freed through the state.
+      list_destroy(list_);
+      delete state_;
+    }
+
+    void swap(list & other) noexcept {
+      std::swap(list_, other.list_);
+      std::swap(state_, other.state_);
+      std::swap(comp_, other.comp_);
+    }
+
+    friend void swap(list & a, list & b) noexcept {
+      a.swap(b);
+    }
+
+    allocator_type get_allocator() const {
+      return Alloc(state_->alloc);
+    }
+
+    /**
+    * handle - Gets the C list under the wrapper, which still owns it.
+    */
+    List handle() const noexcept {
+      return list_;
+    }
+
+    iterator begin() noexcept {
+      return iterator(first());
+    }
+    const_iterator begin() const noexcept {
+      return const_iterator(first());
+    }
+    const_iterator cbegin() const noexcept {
+      return begin();
+    }
+    iterator end() noexcept {
+      return iterator(list_head(list_));
+    }
+    const_iterator end() const noexcept {
+      return const_iterator(list_head(list_));
+    }
+    const_iterator cend() const noexcept {
+      return end();
+    }
+    reverse_iterator rbegin() noexcept {
+      return reverse_iterator(end());
+    }
+    const_reverse_iterator rbegin() const noexcept {
+      return const_reverse_iterator(end());
+    }
+    reverse_iterator rend() noexcept {
+      return reverse_iterator(begin());
+    }
+    const_reverse_iterator rend() const noexcept {
+      return const_reverse_iterator(begin());
+    }
+
+    size_type size() const noexcept {
+      return list_ != nullptr ? list_get_size(list_) : 0;
+    }
+    bool empty() const noexcept {
+      return size() == 0;
+    }
+
+    reference front() {
+      return *begin();
+    }
+    const_reference front() const {
+      return *begin();
+    }
+    reference back() {
+      return *--end();
+    }
+    const_reference back() const {
+      return *--end();
+    }
+
+    template <typename... Args>
+    reference emplace_back(Args &&... args) {
+      T * element = create(state_, std::forward<Args>(args)...);
+      push(element, false);
+      return *element;
+    }
+
+    template <typename... Args>
+    reference emplace_front(Args &&... args) {
+      T * element = create(state_, std::forward<Args>(args)...);
+      push(element, true);
+      return *element;
+    }
+
+    void push_back(const T & value) {
+      emplace_back(value);
+    }
+    void push_back(T && value) {
+      emplace_back(std::move(value));
+    }
+    void push_front(const T & value) {
+      emplace_front(value);
+    }
+    void push_front(T && value) {
+      emplace_front(std::move(value));
+    }
+
+    void pop_front() {
+      destroy(static_cast<T*>(list_pop_front(list_)));
+    }
+    void pop_back() {
+      destroy(static_cast<T*>(list_pop_back(list_)));
+    }
+
+    void clear() noexcept {
+      list_clear(list_);
+    }
+
+    /**
+    * find - Finds the first element equivalent to @value under the
+    *        comparator, like list_find.
+    *
+    * return: An iterator to the element, or end() if there is none.
+    */
+    iterator find(const T & value) {
+      ListNode * head = list_head(list_);
+      ListNode * node = first();
+      while (node != head) {
+        const T & element = *static_cast<const T*>(node->data);
+        if (!comp_(element, value) && !comp_(value, element)) {
+          break;
+        }
+        node = node->next;
+      }
+      return iterator(node);
+    }
+
+    const_iterator find(const T & value) const {
+      return const_cast<list*>(this)->find(value);
+    }
+
+    /**
+    * sort - Sorts the list by relinking its nodes, like list_sort. Equal
+    *        elements keep their order, and iterators stay valid.
+    */
+    void sort() {
+      sort(comp_);
+    }
+
+    template <typename C>
+    void sort(C comp) {
+      ListNode * head = list_head(list_);
+      if (head == nullptr || head->next == head) {
+        return;
+      }
+
+      head->prev->next = nullptr;
+      ListNode * prev = head;
+      for (ListNode * node = sort_chain(head->next, comp); node != nullptr; node = node->next) {
+        node->prev = prev;
+        prev->next = node;
+        prev = node;
+      }
+      prev->next = head;
+      head->prev = prev;
+    }
+
+    friend bool operator==(const list & a, const list & b) {
+      return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+    }
+    friend bool operator!=(const list & a, const list & b) {
+      return !(a == b);
+    }
+  };
+
+  namespace pmr {
+    /**
+    * A list whose nodes and elements come from a std::pmr::memory_resource.
+    */
+    template <typename T, typename Compare = std::less<T>>
+    using list = clist::list<T, Compare, std::pmr::polymorphic_allocator<T>>;
+  }
+}
+
+#endif /* __LIST_HPP__ */
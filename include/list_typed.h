@@ -0,0 +1,151 @@
+/*
+* list_typed.h
+*
+* Generates typed lists of plain values, in the spirit of klist.h:
+*
+*   LIST_DECLARE(intlist, int)
+*
+*   intlist * list = intlist_create();
+*   intlist_push_back(list, 42);
+*   LIST_TYPED_FOREACH(int, value, list) {
+*     printf("%d\n", *value);
+*   }
+*   intlist_destroy(list);
+*
+* A typed list is an inline list (see list_create_inline), so the values live
+* in the nodes, and the generated functions take and return values of the
+* type instead of ListData pointers. Reading the ends, traversals and find are
+* inlined into the caller on the node layout of list.h, with the comparator
+* known at compile time. Everything else, like sort, runs in list.c, and
+* name_list gives the List to use with any other list function.
+*/
+
+#ifndef __LIST_TYPED_H__
+#define __LIST_TYPED_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "list.h"
+
+/**
+* Compares two values with < and >, for arithmetic types.
+*/
+#define LIST_COMPARE_VALUES(a, b) (((a) > (b)) - ((a) < (b)))
+
+/**
+* Loops over the values of a typed list, as pointers into the nodes, like
+* LIST_FOREACH_FORWARD. The list must not be modified inside the loop.
+*/
+#define LIST_TYPED_FOREACH(type, variable, list) \
+	for (ListNode * __node_##variable = list_head((List)(list))->next; \
+			__node_##variable->data != 0; \
+			__node_##variable = __node_##variable->next) \
+		for (type * variable = (type *)__node_##variable->data; variable != 0; variable = 0)
+
+/**
+* LIST_DECLARE - Declares a list of arithmetic values, compared with < and >.
+*
+* @name: The name of the list type, which prefixes its functions.
+* @type: The type of the values.
+*/
+#define LIST_DECLARE(name, type) LIST_DECLARE_CMP(name, type, LIST_COMPARE_VALUES)
+
+/**
+* LIST_DECLARE_CMP - Declares a list of values of a plain type, e.g. a struct
+*                    without pointers it owns.
+*
+* @name: The name of the list type, which prefixes its functions.
+* @type: The type of the values.
+* @cmp:  A function or macro which compares two values, and returns a
+*        negative number, 0 or a positive number like ListCompareFunction.
+*/
+#define LIST_DECLARE_CMP(name, type, cmp) \
+	typedef struct name##_t name; \
+	\
+	static inline int name##_compare(const ListData * a, const ListData * b) { \
+		return cmp(*(const type *)a, *(const type *)b); \
+	} \
+	\
+	static inline name * name##_create_with_allocator(const ListAllocator * allocator) { \
+		return (name *)list_create_inline(sizeof(type), name##_compare, allocator); \
+	} \
+	\
+	static inline name * name##_create(void) { \
+		return name##_create_with_allocator(list_malloc_allocator()); \
+	} \
+	\
+	static inline void name##_destroy(name * list) { \
+		list_destroy((List)list); \
+	} \
+	\
+	static inline List name##_list(name * list) { \
+		return (List)list; \
+	} \
+	\
+	static inline size_t name##_size(const name * list) { \
+		return list_get_size((List)list); \
+	} \
+	\
+	static inline ListStatus name##_push_back(name * list, type value) { \
+		return list_push_back((List)list, &value); \
+	} \
+	\
+	static inline ListStatus name##_push_front(name * list, type value) { \
+		return list_push_front((List)list, &value); \
+	} \
+	\
+	/* pointers into the nodes, or NULL pointer if the list is empty. */ \
+	static inline type * name##_front(const name * list) { \
+		return (type *)list_head((List)list)->next->data; \
+	} \
+	\
+	static inline type * name##_back(const name * list) { \
+		return (type *)list_head((List)list)->prev->data; \
+	} \
+	\
+	static inline type * name##_at(const name * list, size_t n) { \
+		return (type *)list_get_at((List)list, n); \
+	} \
+	\
+	/* the value is copied to @value if it is not NULL pointer. removing */ \
+	/* the node does not allocate, unlike list_pop_front on inline lists. */ \
+	static inline bool name##_pop_front(name * list, type * value) { \
+		type * front = name##_front(list); \
+		if (front == 0) { \
+			return false; \
+		} \
+		if (value != 0) { \
+			*value = *front; \
+		} \
+		list_remove_at((List)list, 0); \
+		return true; \
+	} \
+	\
+	static inline bool name##_pop_back(name * list, type * value) { \
+		type * back = name##_back(list); \
+		if (back == 0) { \
+			return false; \
+		} \
+		if (value != 0) { \
+			*value = *back; \
+		} \
+		list_remove_at((List)list, name##_size(list) - 1); \
+		return true; \
+	} \
+	\
+	/* a linear scan from the front, which ignores hash indexes. */ \
+	static inline type * name##_find(const name * list, type value) { \
+		ListNode * head = list_head((List)list); \
+		for (ListNode * node = head->next; node != head; node = node->next) { \
+			if (cmp(*(const type *)node->data, value) == 0) { \
+				return (type *)node->data; \
+			} \
+		} \
+		return 0; \
+	} \
+	\
+	static inline ListStatus name##_sort(name * list) { \
+		return list_sort((List)list); \
+	}
+
+#endif /* __LIST_TYPED_H__ */
@@ -29,21 +29,69 @@
 *      Author: Aviad Gafni
 */
 
+#include <stddef.h> // ptrdiff_t
 #include <stdlib.h> // malloc, free
+#include <string.h> // memcpy
+#include <pthread.h>
+#include <sched.h> // sched_yield
 #include "list.h"
 #include "listConfig.h"
 
-typedef struct node_t {
-  ListData* data;
-  struct node_t *next, *prev;
-} Node;
+typedef ListNode Node;
+
+typedef struct {
+  Node* node;     // NULL pointer if the slot is empty
+  size_t hash;
+} IndexSlot;
+
+// open addressing hash table which maps elements to their nodes. lists which
+// share their nodes copy-on-write share their index too, read-only.
+typedef struct {
+  ListHashFunction hash;
+  IndexSlot* slots;
+  size_t capacity;  // a power of 2
+  size_t count;
+  size_t refs;      // lists which use the index
+} HashIndex;
+
+// a registered reader of an RCU list.
+struct list_reader_t {
+  List list;
+  uint64_t period;     // the grace period its section started in, 0 outside
+  unsigned nesting;    // only the outermost section counts
+  struct list_reader_t* next;
+};
+
+// RCU lists let readers traverse them while writers change them. a node which
+// is removed is only freed after a grace period, once every reader which
+// might still see it left its read-side section.
+typedef struct {
+  pthread_mutex_t writer;        // writers run one at a time
+  pthread_mutex_t readers_lock;  // guards the list of readers
+  ListReader readers;
+  uint64_t period;
+  Node** deferred;               // unlinked nodes waiting for a grace period
+  size_t deferred_count;
+  size_t deferred_capacity;
+} RcuState;
 
 struct list_t {
   size_t size;
   ListCopyFunction data_copy;
   ListFreeFunction data_free;
   ListCompareFunction data_compare;
-  Node* iterator;
+  ListAllocator allocator;
+  void* allocator_state;
+  size_t elem_size;       // size of inline elements, or 0 if the list holds pointers
+  size_t payload_offset;  // offset of the inline element in its node
+  size_t node_size;
+  HashIndex* index;       // NULL pointer if the list has no hash index
+  pthread_mutex_t* locks; // NULL pointer unless the list is concurrent
+  RcuState* rcu;          // NULL pointer unless the list is an RCU list
+  size_t* shares;         // number of lists sharing the nodes, NULL pointer if
+                          // they are not shared with copy-on-write copies
+  bool read_only;         // snapshots do not change
+  Node* iterator;         // position of list_get_* calls without an iterator
   Node* head;
 };
 
@@ -52,8 +100,227 @@ struct list_iterator_t {
   Node * node;
   bool end_edge;   // iterator reached edges of list
   bool start_edge;
+  bool heap;       // allocated by list_iterator_create/copy
+};
+
+// fails to compile if an iterator does not fit in ListIteratorStorage.
+typedef char __iterator_fits_storage[
+  (sizeof(struct list_iterator_t) <= sizeof(ListIteratorStorage)) ? 1 : -1];
+
+typedef struct queue_node_t {
+  ListData* data;
+  struct queue_node_t* next;
+} QueueNode;
+
+#define QUEUE_HAZARDS 2
+
+// hazard pointers of a queue operation. a thread claims a record for every
+// operation, and nodes it removes from the queue wait in the record until no
+// record has a hazard pointer to them.
+typedef struct hazard_record_t {
+  QueueNode* hazards[QUEUE_HAZARDS];
+  bool active;
+  QueueNode** retired;
+  size_t retired_count;
+  size_t retired_capacity;
+  struct hazard_record_t* next;
+} HazardRecord;
+
+#define CACHE_LINE 64
+
+// Michael-Scott queue. producers and consumers work on different cache lines.
+struct list_queue_t {
+  QueueNode* head;  // a dummy node, whose element was popped already
+  char head_pad[CACHE_LINE - sizeof(QueueNode*)];
+  QueueNode* tail;
+  char tail_pad[CACHE_LINE - sizeof(QueueNode*)];
+  HazardRecord* records;
+  size_t record_count;
+  ListCopyFunction data_copy;
+  ListFreeFunction data_free;
+};
+
+// nodes detached from a list by list_clear_async or list_destroy_async,
+// along with what it takes to free them once the list has moved on.
+typedef struct garbage_t {
+  Node* chain;                 // linked through next, up to NULL pointer
+  size_t count;                // number of nodes in the chain
+  ListFreeFunction data_free;  // NULL pointer if the elements are inline
+  ListAllocator allocator;
+  void* allocator_state;
+  bool own_state;              // the state left the list along with the nodes,
+                               // and is destroyed after them
+  HashIndex* index;            // index of the nodes, NULL pointer if none
+  struct garbage_t* next;
+} Garbage;
+
+// a FIFO of garbage, freed on list_reclaim_step or on a thread of its own.
+struct list_reclaimer_t {
+  pthread_mutex_t lock;    // guards the garbage and stop
+  pthread_cond_t pending;  // signaled on new garbage and on stop
+  Garbage* first;
+  Garbage* last;
+  bool stop;
+  bool background;         // has a thread of its own
+  pthread_t thread;
+};
+
+/******************************************************************************
+*                         Node allocators                                     *
+******************************************************************************/
+
+static void* malloc_alloc(void* state, size_t node_size) {
+  (void)state;
+  return malloc(node_size);
+}
+
+static void malloc_free(void* state, void* node) {
+  (void)state;
+  free(node);
+}
+
+// the allocator used by list_create.
+static const ListAllocator malloc_allocator = {
+  0, 0, malloc_alloc, malloc_free, 0, 0
+};
+
+// used to align nodes to the strictest fundamental alignment.
+typedef union {
+  long double ld;
+  long long ll;
+  void* p;
+  void(*f)(void);
+} MaxAlign;
+
+#define ALIGN_UP(size) \
+	(((size) + sizeof(MaxAlign) - 1) / sizeof(MaxAlign) * sizeof(MaxAlign))
+
+#define SLAB_FIRST_CHUNK_NODES 32
+#define SLAB_MAX_CHUNK_NODES 8192
+
+typedef struct slab_chunk_t {
+  struct slab_chunk_t* next;
+} SlabChunk;
+
+typedef struct slab_free_node_t {
+  struct slab_free_node_t* next;
+} SlabFreeNode;
+
+typedef struct slab_t {
+  size_t node_size;
+  size_t chunk_nodes;    // number of nodes in the next chunk to allocate
+  SlabChunk* chunks;
+  char* cursor;          // next never-used node in the newest chunk
+  char* limit;
+  SlabFreeNode* free_list;
+} Slab;
+
+static void* slab_create(size_t node_size, void* arg) {
+  (void)arg;
+  Slab* slab = malloc(sizeof(*slab));
+  if (slab == 0) {
+    return 0;
+  }
+
+  if (node_size < sizeof(SlabFreeNode)) {
+    node_size = sizeof(SlabFreeNode);
+  }
+  slab->node_size = ALIGN_UP(node_size);
+  slab->chunk_nodes = SLAB_FIRST_CHUNK_NODES;
+  slab->chunks = 0;
+  slab->cursor = slab->limit = 0;
+  slab->free_list = 0;
+
+  return slab;
+}
+
+static void slab_release(void* state) {
+  Slab* slab = state;
+  while (slab->chunks != 0) {
+    SlabChunk* next = slab->chunks->next;
+    free(slab->chunks);
+    slab->chunks = next;
+  }
+
+  slab->chunk_nodes = SLAB_FIRST_CHUNK_NODES;
+  slab->cursor = slab->limit = 0;
+  slab->free_list = 0;
+}
+
+static void slab_destroy(void* state) {
+  slab_release(state);
+  free(state);
+}
+
+// starts a new chunk of a given number of nodes. chunks grow geometrically,
+// so small lists stay small.
+static bool slab_grow(Slab* slab, size_t nodes) {
+  size_t header = ALIGN_UP(sizeof(SlabChunk));
+  SlabChunk* chunk = malloc(header + slab->node_size * nodes);
+  if (chunk == 0) {
+    return false;
+  }
+
+  chunk->next = slab->chunks;
+  slab->chunks = chunk;
+  slab->cursor = (char*)chunk + header;
+  slab->limit = slab->cursor + slab->node_size * nodes;
+  if (slab->chunk_nodes < SLAB_MAX_CHUNK_NODES) {
+    slab->chunk_nodes *= 2;
+  }
+
+  return true;
+}
+
+static void* slab_alloc(void* state, size_t node_size) {
+  (void)node_size;
+  Slab* slab = state;
+  if (slab->free_list != 0) {
+    SlabFreeNode* node = slab->free_list;
+    slab->free_list = node->next;
+    return node;
+  }
+
+  if (slab->cursor == slab->limit && !slab_grow(slab, slab->chunk_nodes)) {
+    return 0;
+  }
+
+  void* node = slab->cursor;
+  slab->cursor += slab->node_size;
+  return node;
+}
+
+// makes the next count allocations, when the free list is empty, carve
+// consecutive nodes out of a single chunk. the rest of the newest chunk is
+// left unused.
+static bool slab_reserve(void* state, size_t count) {
+  Slab* slab = state;
+  if (slab->free_list != 0 || (size_t)(slab->limit - slab->cursor) / slab->node_size >= count) {
+    return true;
+  }
+
+  return slab_grow(slab, count > slab->chunk_nodes ? count : slab->chunk_nodes);
+}
+
+static void slab_free(void* state, void* node) {
+  Slab* slab = state;
+  SlabFreeNode* free_node = node;
+  free_node->next = slab->free_list;
+  slab->free_list = free_node;
+}
+
+static const ListAllocator slab_allocator = {
+  slab_create, slab_destroy, slab_alloc, slab_free, slab_release, 0
 };
 
+const ListAllocator * list_malloc_allocator(void) {
+  return &malloc_allocator;
+}
+
+const ListAllocator * list_slab_allocator(void) {
+  return &slab_allocator;
+}
+
 
 /******************************************************************************
 *                    Functions that works on a node                           *
@@ -65,8 +332,8 @@ typedef enum {
   NODE_EINVAL
 } NodeStatus;
 
-static Node* node_create() {
-  Node* new = malloc(sizeof(*new));
+static Node* node_create(const List list) {
+  Node* new = list->allocator.alloc(list->allocator_state, list->node_size);
   if (new == 0) {
     return 0;
   }
@@ -76,46 +343,196 @@ static Node* node_create() {
   return new;
 }
 
-static void node_destroy(Node* node, ListFreeFunction data_free) {
+// frees the node itself, without its data.
+static void node_free(const List list, Node* node) {
+  list->allocator.free(list->allocator_state, node);
+}
+
+static void node_destroy(const List list, Node* node) {
   if (node != 0) {
     // avoid freeing when there's nothing to free.
     // maybe the user supplied "data_free" function cannot handle NULL pointer.
-    if (node->data != 0)
-      data_free(node->data);
-    free(node);
+    // inline elements are freed along with their node.
+    if (node->data != 0 && list->elem_size == 0)
+      list->data_free(node->data);
+    node_free(list, node);
+  }
+}
+
+static ListData* node_payload(const List list, Node* node) {
+  return (char*)node + list->payload_offset;
+}
+
+static NodeStatus node_set(const List list, Node* node, const ListData* data) {
+  if (node == 0 || data == 0) {
+    return NODE_EINVAL;
+  }
+
+  if (list->elem_size != 0) {
+    node->data = memcpy(node_payload(list, node), data, list->elem_size);
+    return NODE_SUCCESS;
+  }
+
+  node->data = list->data_copy(data);
+  if (node->data == 0) {
+    return NODE_NO_MEM;
   }
+
+  return NODE_SUCCESS;
 }
 
 // not used at the moment.
-static Node* node_copy(Node* to_copy, ListCopyFunction data_copy, ListFreeFunction data_free) {
-  if (to_copy == 0 || data_copy == 0) {
+static Node* node_copy(const List list, Node* to_copy) {
+  if (to_copy == 0) {
     return 0;
   }
 
-  Node* new = node_create();
+  Node* new = node_create(list);
   if (new == 0) {
     return 0;
   }
 
-  new->data = data_copy(to_copy->data);
-  if (new->data == 0) {
-    node_destroy(new, data_free);
+  if (node_set(list, new, to_copy->data) != NODE_SUCCESS) {
+    node_destroy(list, new);
+    return 0;
   }
 
   return new;
 }
 
-static NodeStatus node_set(Node* node, const ListData* data, ListCopyFunction data_copy) {
-  if (node == 0 || data == 0 || data_copy == 0) {
-    return NODE_EINVAL;
+
+/******************************************************************************
+*                            Hash index                                       *
+******************************************************************************/
+
+// the table is kept at most half full, and collisions are resolved with
+// linear probing.
+#define INDEX_MIN_CAPACITY 16
+
+static HashIndex* index_create(ListHashFunction hash) {
+  HashIndex* index = malloc(sizeof(*index));
+  if (index == 0) {
+    return 0;
   }
 
-  node->data = data_copy(data);
-  if (node->data == 0) {
-    return NODE_NO_MEM;
+  index->slots = calloc(INDEX_MIN_CAPACITY, sizeof(*index->slots));
+  if (index->slots == 0) {
+    free(index);
+    return 0;
   }
+  index->hash = hash;
+  index->capacity = INDEX_MIN_CAPACITY;
+  index->count = 0;
+  index->refs = 1;
 
-  return NODE_SUCCESS;
+  return index;
+}
+
+static HashIndex* index_share(HashIndex* index) {
+  if (index != 0) {
+    __atomic_add_fetch(&index->refs, 1, __ATOMIC_RELAXED);
+  }
+
+  return index;
+}
+
+// drops a reference to an index, and frees it with the last one.
+static void index_destroy(HashIndex* index) {
+  if (index != 0 && __atomic_sub_fetch(&index->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+    free(index->slots);
+    free(index);
+  }
+}
+
+static void index_clear(HashIndex* index) {
+  memset(index->slots, 0, sizeof(*index->slots) * index->capacity);
+  index->count = 0;
+}
+
+static void __index_place(IndexSlot* slots, size_t capacity, Node* node, size_t hash) {
+  size_t i = hash & (capacity - 1);
+  while (slots[i].node != 0) {
+    i = (i + 1) & (capacity - 1);
+  }
+  slots[i].node = node;
+  slots[i].hash = hash;
+}
+
+// makes room for count more nodes, so that inserting them cannot fail.
+static bool index_reserve(HashIndex* index, size_t count) {
+  if ((index->count + count) * 2 > index->capacity) {
+    size_t capacity = index->capacity * 2;
+    while ((index->count + count) * 2 > capacity) {
+      capacity *= 2;
+    }
+    IndexSlot* slots = calloc(capacity, sizeof(*slots));
+    if (slots == 0) {
+      return false;
+    }
+
+    for (size_t i = 0; i < index->capacity; ++i) {
+      if (index->slots[i].node != 0) {
+        __index_place(slots, capacity, index->slots[i].node, index->slots[i].hash);
+      }
+    }
+    free(index->slots);
+    index->slots = slots;
+    index->capacity = capacity;
+  }
+
+  return true;
+}
+
+static bool index_insert(HashIndex* index, Node* node) {
+  if (!index_reserve(index, 1)) {
+    return false;
+  }
+
+  __index_place(index->slots, index->capacity, node, index->hash(node->data));
+  ++index->count;
+
+  return true;
+}
+
+static void index_remove(HashIndex* index, Node* node) {
+  size_t mask = index->capacity - 1;
+  size_t i = index->hash(node->data) & mask;
+  while (index->slots[i].node != node) {
+    i = (i + 1) & mask;
+  }
+
+  // shift back the following slots of the cluster which may not be placed
+  // after the hole, so that lookups do not stop at it.
+  for (size_t j = (i + 1) & mask; index->slots[j].node != 0; j = (j + 1) & mask) {
+    size_t home = index->slots[j].hash & mask;
+    if (((j - home) & mask) >= ((j - i) & mask)) {
+      index->slots[i] = index->slots[j];
+      i = j;
+    }
+  }
+  index->slots[i].node = 0;
+  --index->count;
+}
+
+// finds a node holding an element equal to data. @unique is set to false if
+// there are more equal elements in the index.
+static Node* index_find(HashIndex* index, ListCompareFunction data_compare,
+                        const ListData* data, bool* unique) {
+  size_t mask = index->capacity - 1;
+  size_t hash = index->hash(data);
+  Node* found = 0;
+  *unique = true;
+  for (size_t i = hash & mask; index->slots[i].node != 0; i = (i + 1) & mask) {
+    if (index->slots[i].hash == hash && data_compare(data, index->slots[i].node->data) == 0) {
+      if (found != 0) {
+        *unique = false;
+        break;
+      }
+      found = index->slots[i].node;
+    }
+  }
+
+  return found;
 }
 
 
@@ -137,7 +554,21 @@ static Node* __list_get_last(List list) {
 		iterator->data != 0;\
 		iterator = iterator->next )
 
+// returns the first node in forward order holding an element equal to data,
+// or the head if there is no such node.
 static Node* __find_node(const List list, const ListData* data) {
+  if (list->index != 0) {
+    bool unique;
+    Node* found = index_find(list->index, list->data_compare, data, &unique);
+    if (found == 0) {
+      return list->head;
+    }
+    // only a scan can tell which one of several equal elements comes first.
+    if (unique) {
+      return found;
+    }
+  }
+
   Node* iterator = 0;
   list_foreach(iterator, list) {
     if (list->data_compare(data, iterator->data) == 0) {
@@ -148,722 +579,3427 @@ static Node* __find_node(const List list, const ListData* data) {
   return iterator;
 }
 
-static ListStatus NodeStatus_to_ListStatus(NodeStatus status) {
-  switch (status) {
-  case NODE_SUCCESS:
-    return LIST_SUCCESS;
-  case NODE_NO_MEM:
-    return LIST_NO_MEM;
-  case NODE_EINVAL:
-    return LIST_EINVAL;
-  default:
-    return LIST_SUCCESS;
+// returns the node at a given index, or the head if n equals the list size.
+// the list is walked from whichever end is closer to the index.
+static Node* __node_at(const List list, size_t n) {
+  Node* iterator;
+  if (n <= list->size / 2) {
+    iterator = __list_get_first(list);
+    while (n-- > 0) {
+      iterator = iterator->next;
+    }
+  } else {
+    iterator = list->head;
+    for (size_t i = list->size; i > n; --i) {
+      iterator = iterator->prev;
+    }
   }
+
+  return iterator;
 }
 
-List list_create(ListCopyFunction data_copy, ListFreeFunction data_free, ListCompareFunction data_compare) {
-  if (data_copy == 0 || data_free == 0 || data_compare == 0) {
-    return 0;
+// operations on disjoint parts of a concurrent list run at the same time,
+// and readers of RCU lists read the size while it changes, so shared lists
+// update it atomically.
+static void __add_size(List list, ptrdiff_t delta) {
+  if (list->locks != 0 || list->rcu != 0) {
+    __atomic_fetch_add(&list->size, (size_t)delta, __ATOMIC_RELAXED);
+  } else {
+    list->size += (size_t)delta;
   }
+}
 
-  List new_list = malloc(sizeof(*new_list));
-  if (new_list == 0) {
-    return 0;
+// links a node into the list, before a given node of the list. the node is
+// complete before it is published, for readers of RCU lists.
+static ListStatus __link_before(List list, Node* position, Node* node) {
+  if (list->index != 0 && !index_insert(list->index, node)) {
+    return LIST_NO_MEM;
   }
 
-  new_list->size = 0;
-  new_list->iterator = new_list->head = 0;
-  new_list->data_copy = data_copy;
-  new_list->data_free = data_free;
-  new_list->data_compare = data_compare;
-  new_list->head = node_create();
-  if (new_list->head == 0) {
-    free(new_list);
-    return 0;
-  }
-  new_list->head->next = new_list->head->prev = new_list->head;
-  // list head data is initialized already to NULL pointer - this is very
-  // important, since in order to destroy the head without any issues free
-  // needs a NULL pointer.
-  new_list->iterator = new_list->head;
+  Node* prev = position->prev;
+  node->prev = prev;
+  node->next = position;
+  __atomic_store_n(&prev->next, node, __ATOMIC_RELEASE);
+  __atomic_store_n(&position->prev, node, __ATOMIC_RELEASE);
+  __add_size(list, 1);
 
-  return new_list;
+  return LIST_SUCCESS;
 }
 
-ListData * list_get_first(const List list, ListIterator iterator) {
-  if (list == 0) {
-    return 0;
+// unlinks a node from the list without freeing it.
+static void __unlink(List list, Node* node) {
+  // fix the iterator if it points to the unlinked node
+  if (list->iterator == node) {
+    list->iterator = node->next;
   }
 
-  list->iterator = __list_get_first(list);
-  if (iterator != 0) {
-    if (iterator->list != list) {
-      return 0;
-    }
-
-    iterator->node = list->iterator;
-    if (iterator->node == list->head) {
-      iterator->start_edge = true;
-    } else {
-      iterator->start_edge = false;
-    }
+  if (list->index != 0) {
+    index_remove(list->index, node);
   }
 
-  // if list->iterator points to the head it's ok, since head's data is
-  // always NULL.
-  return list->iterator->data;
+  // the links of the node itself are left as is, so that readers of RCU lists
+  // which are on the node can move on.
+  __atomic_store_n(&node->prev->next, node->next, __ATOMIC_RELEASE);
+  __atomic_store_n(&node->next->prev, node->prev, __ATOMIC_RELEASE);
+  __add_size(list, -1);
 }
 
-ListData * list_get_last(const List list, ListIterator iterator) {
-  if (list == 0) {
-    return 0;
-  }
-
-  list->iterator = __list_get_last(list);;
-  if (iterator != 0) {
-    if (iterator->list != list) {
-      return 0;
-    }
+// chains are nodes linked through next only, terminated with NULL pointer.
+// prev pointers are fixed once a chain is linked back into a list.
 
-    iterator->node = list->iterator;
-    if (iterator->node == list->head) {
-      iterator->end_edge = true;
-    } else {
-      iterator->end_edge = false;
-    }
-  }
+// detaches all the nodes from the list into a chain, leaving it empty.
+static Node* __detach_chain(List list) {
+  Node* first = __list_get_first(list);
+  __list_get_last(list)->next = 0;
+  list->head->next = list->head->prev = list->head;
+  list->iterator = list->head;
 
-  // if list->iterator points to the head it's ok, since head's data is
-  // always NULL.
-  return list->iterator->data;
+  return first == list->head ? 0 : first;
 }
 
-ListData * list_get_next(const List list, ListIterator iterator) {
-  // note that if we reached to end of list, the iterator does not advance,
-  // and we return NULL.
-  if (list == 0) {
-    return 0;
+// links a chain back into an empty list, fixing the prev pointers.
+static void __attach_chain(List list, Node* chain) {
+  Node* prev = list->head;
+  for (Node* node = chain; node != 0; node = node->next) {
+    node->prev = prev;
+    prev->next = node;
+    prev = node;
   }
 
-  if (iterator != 0) {
-    // if the iterator is on an edge, we return NULL pointer.
-    if (list != iterator->list || iterator->end_edge) {
-      return 0;
-    }
+  prev->next = list->head;
+  list->head->prev = prev;
+}
 
-    iterator->node = iterator->node->next;
-    if (iterator->node == list->head) {
-      iterator->end_edge = true;
-    }
-  }
+// concurrent lists guard their links with striped locks. the lock of a node
+// guards both of its links, except for the head, whose next link is guarded
+// by the front lock and whose prev link by the back lock, so that both ends
+// of the list can change at the same time.
+#define LOCK_STRIPES 64
+#define FRONT_LOCK 0
+#define BACK_LOCK (LOCK_STRIPES + 1)
+#define LOCK_COUNT (LOCK_STRIPES + 2)
 
-  list->iterator = list->iterator->next;
+static pthread_mutex_t* __node_lock(const List list, const Node* node) {
+  uintptr_t h = (uintptr_t)node >> 4;
+  h ^= (h >> 6) ^ (h >> 12);
 
-  // if list->iterator points to the head it's ok, since head's data is
-  // always NULL.
-  return list->iterator->data;
+  return &list->locks[1 + h % LOCK_STRIPES];
 }
 
-ListData * list_get_prev(const List list, ListIterator iterator) {
-  // note that if we reached to start of list, the iterator does not regress,
-  // and we return NULL.
-  if (list == 0) {
-    return 0;
-  }
+static pthread_mutex_t* __next_lock(const List list, const Node* node) {
+  return node == list->head ? &list->locks[FRONT_LOCK] : __node_lock(list, node);
+}
 
-  if (iterator != 0) {
-    // if the iterator is on an edge, we return NULL pointer.
-    if (list != iterator->list || iterator->start_edge) {
-      return 0;
-    }
+static pthread_mutex_t* __prev_lock(const List list, const Node* node) {
+  return node == list->head ? &list->locks[BACK_LOCK] : __node_lock(list, node);
+}
 
-    iterator->node = iterator->node->prev;
-    if (iterator->node == list->head) {
-      iterator->start_edge = true;
-    }
+static ListStatus __init_locks(List list) {
+  list->locks = malloc(sizeof(*list->locks) * LOCK_COUNT);
+  if (list->locks == 0) {
+    return LIST_NO_MEM;
   }
 
-  list->iterator = list->iterator->prev;
+  for (size_t i = 0; i < LOCK_COUNT; ++i) {
+    pthread_mutex_init(&list->locks[i], 0);
+  }
 
-  // if list->iterator points to the head it's ok, since head's data is
-  // always NULL.
-  return list->iterator->data;
+  return LIST_SUCCESS;
 }
 
-ListData * list_get_at(const List list, size_t n) {
-  if (n >= list->size) {
-    return 0;
+static void __destroy_locks(List list) {
+  if (list->locks != 0) {
+    for (size_t i = 0; i < LOCK_COUNT; ++i) {
+      pthread_mutex_destroy(&list->locks[i]);
+    }
+    free(list->locks);
+    list->locks = 0;
   }
+}
 
-  Node * iterator;
-  list_foreach(iterator, list) {
-    if (n-- == 0) {
-      break;
+// operations other than pushing and popping at the ends and through
+// iterators take all the locks of a concurrent list, in order. on RCU lists
+// they take the writer lock, like all the other writers.
+static void __lock_all(const List list) {
+  if (list->locks != 0) {
+    for (size_t i = 0; i < LOCK_COUNT; ++i) {
+      pthread_mutex_lock(&list->locks[i]);
     }
+  } else if (list->rcu != 0) {
+    pthread_mutex_lock(&list->rcu->writer);
   }
-
-  return iterator->data;
 }
 
-ListStatus list_push_front(List list, const ListData* data) {
-  if (list == 0 || data == 0) {
-    return LIST_EINVAL;
+static void __unlock_all(const List list) {
+  if (list->locks != 0) {
+    for (size_t i = LOCK_COUNT; i > 0; --i) {
+      pthread_mutex_unlock(&list->locks[i - 1]);
+    }
+  } else if (list->rcu != 0) {
+    pthread_mutex_unlock(&list->rcu->writer);
   }
+}
 
-  ListIterator iterator = list_iterator_create(list);
-  if (iterator == 0) {
-    return LIST_NO_MEM;
+// operations which only read the list. on RCU lists they run in the
+// read-side section of the caller, like traversals.
+static void __lock_readers(const List list) {
+  if (list->rcu == 0) {
+    __lock_all(list);
   }
+}
 
-  iterator->node = iterator->list->head;
-  ListStatus res = list_push_after(list, iterator, data);
-  list_iterator_destroy(iterator);
+static void __unlock_readers(const List list) {
+  if (list->rcu == 0) {
+    __unlock_all(list);
+  }
+}
 
-  return res;
+// lists used by several threads at once, which do not keep a position for
+// list_get_next.
+static bool __is_shared(const List list) {
+  return list->locks != 0 || list->rcu != 0;
 }
 
-ListStatus list_push_back(List list, const ListData* data) {
-  if (list == 0 || data == 0) {
-    return LIST_EINVAL;
-  }
+// the locks a single operation holds. only the first one is waited for, the
+// others are tried, and on failure the whole set is released so that the
+// operation starts over. holding a lock while waiting for another one could
+// deadlock, since operations lock their nodes in no particular order.
+typedef struct {
+  pthread_mutex_t* held[3];
+  size_t count;
+} LockSet;
 
-  ListIterator iterator = list_iterator_create(list);
-  if (iterator == 0) {
-    return LIST_NO_MEM;
+static void __lockset_release(LockSet* set) {
+  while (set->count > 0) {
+    pthread_mutex_unlock(set->held[--set->count]);
   }
+}
 
-  iterator->node = iterator->list->head;
-  iterator->start_edge = false;
-  ListStatus res = list_push_before(list, iterator, data);
-  list_iterator_destroy(iterator);
-
-  return res;
+static void __lockset_init(LockSet* set, pthread_mutex_t* lock) {
+  pthread_mutex_lock(lock);
+  set->held[0] = lock;
+  set->count = 1;
 }
 
-ListStatus list_push_after(List list, const ListIterator iterator, const ListData* data) {
-  if (list == 0 || data == 0 || iterator == 0 || list != iterator->list || iterator->end_edge) {
-    return LIST_EINVAL;
+static bool __lockset_try(LockSet* set, pthread_mutex_t* lock) {
+  // nodes may share a stripe.
+  for (size_t i = 0; i < set->count; ++i) {
+    if (set->held[i] == lock) {
+      return true;
+    }
   }
 
-  Node* new = node_create();
-  if (new == 0) {
-    return LIST_NO_MEM;
+  if (pthread_mutex_trylock(lock) != 0) {
+    __lockset_release(set);
+    sched_yield();
+    return false;
   }
+  set->held[set->count++] = lock;
 
-  NodeStatus res = node_set(new, data, list->data_copy);
-  if (res != NODE_SUCCESS) {
-    node_destroy(new, list->data_free);
-    return NodeStatus_to_ListStatus(res);
+  return true;
+}
+
+// reads a link of a node, under the lock which guards it in concurrent lists.
+// readers of RCU lists see the nodes complete once they see the links to them.
+// if @data is not NULL pointer, it gets the data of the linked node, read
+// under the same lock, since the node cannot be unlinked and freed by a pop
+// while its link is locked.
+static Node* __next_of(const List list, Node* node, ListData** data) {
+  if (list->locks == 0) {
+    Node* next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE);
+    if (data != 0) {
+      *data = next->data;
+    }
+    return next;
   }
 
-  // link the new node
-  Node * next = iterator->node->next;
-  next->prev = new;
-  new->next = next;
-  new->prev = iterator->node;
-  iterator->node->next = new;
-  ++list->size;
+  pthread_mutex_t* lock = __next_lock(list, node);
+  pthread_mutex_lock(lock);
+  Node* next = node->next;
+  if (data != 0) {
+    *data = next->data;
+  }
+  pthread_mutex_unlock(lock);
 
-  return LIST_SUCCESS;
+  return next;
 }
 
-ListStatus list_push_before(List list, const ListIterator iterator, const ListData* data) {
-  if (list == 0 || data == 0 || iterator == 0 || list != iterator->list || iterator->start_edge) {
-    return LIST_EINVAL;
+static Node* __prev_of(const List list, Node* node, ListData** data) {
+  if (list->locks == 0) {
+    Node* prev = __atomic_load_n(&node->prev, __ATOMIC_ACQUIRE);
+    if (data != 0) {
+      *data = prev->data;
+    }
+    return prev;
   }
 
-  Node* new = node_create();
-  if (new == 0) {
-    return LIST_NO_MEM;
+  pthread_mutex_t* lock = __prev_lock(list, node);
+  pthread_mutex_lock(lock);
+  Node* prev = node->prev;
+  if (data != 0) {
+    *data = prev->data;
   }
+  pthread_mutex_unlock(lock);
 
-  NodeStatus res = node_set(new, data, list->data_copy);
-  if (res != NODE_SUCCESS) {
-    node_destroy(new, list->data_free);
-    return NodeStatus_to_ListStatus(res);
+  return prev;
+}
+
+// waits until every reader which was in a read-side section when it was
+// called left it. nodes unlinked before are not reachable after.
+static void __rcu_wait(List list) {
+  RcuState* rcu = list->rcu;
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  uint64_t period = __atomic_add_fetch(&rcu->period, 1, __ATOMIC_SEQ_CST);
+
+  pthread_mutex_lock(&rcu->readers_lock);
+  for (ListReader reader = rcu->readers; reader != 0; reader = reader->next) {
+    for (;;) {
+      uint64_t seen = __atomic_load_n(&reader->period, __ATOMIC_ACQUIRE);
+      if (seen == 0 || seen >= period) {
+        break;
+      }
+      sched_yield();
+    }
+  }
+  pthread_mutex_unlock(&rcu->readers_lock);
+}
+
+// frees the nodes removed so far. the caller holds the writer lock.
+static void __rcu_flush(List list) {
+  RcuState* rcu = list->rcu;
+  if (rcu->deferred_count == 0) {
+    return;
+  }
+
+  __rcu_wait(list);
+  for (size_t i = 0; i < rcu->deferred_count; ++i) {
+    node_destroy(list, rcu->deferred[i]);
+  }
+  rcu->deferred_count = 0;
+}
+
+// frees an unlinked node of an RCU list after a grace period. the nodes are
+// freed in batches, so that writers seldom wait for readers.
+#define RCU_BATCH 64
+
+static void __rcu_defer(List list, Node* node) {
+  RcuState* rcu = list->rcu;
+  if (rcu->deferred_count == rcu->deferred_capacity) {
+    Node** deferred = realloc(rcu->deferred, sizeof(*deferred) * RCU_BATCH);
+    if (deferred == 0) {
+      // without room for the node, it is freed right away.
+      __rcu_wait(list);
+      node_destroy(list, node);
+      return;
+    }
+    rcu->deferred = deferred;
+    rcu->deferred_capacity = RCU_BATCH;
   }
 
-  Node* prev = iterator->node->prev;
-  prev->next = new;
-  new->prev = prev;
-  new->next = iterator->node;
-  iterator->node->prev = new;
-  ++list->size;
+  rcu->deferred[rcu->deferred_count++] = node;
+  if (rcu->deferred_count == RCU_BATCH) {
+    __rcu_flush(list);
+  }
+}
+
+// frees a node which was unlinked from the list.
+static void __dispose(List list, Node* node) {
+  if (list->rcu == 0) {
+    node_destroy(list, node);
+    return;
+  }
+
+  pthread_mutex_lock(&list->rcu->writer);
+  __rcu_defer(list, node);
+  pthread_mutex_unlock(&list->rcu->writer);
+}
+
+static ListStatus __init_rcu(List list) {
+  RcuState* rcu = malloc(sizeof(*rcu));
+  if (rcu == 0) {
+    return LIST_NO_MEM;
+  }
+
+  pthread_mutex_init(&rcu->writer, 0);
+  pthread_mutex_init(&rcu->readers_lock, 0);
+  rcu->readers = 0;
+  rcu->period = 1;
+  rcu->deferred = 0;
+  rcu->deferred_count = rcu->deferred_capacity = 0;
+  list->rcu = rcu;
 
   return LIST_SUCCESS;
 }
 
+// readers are unregistered before the list is destroyed, and so do not wait.
+static void __destroy_rcu(List list) {
+  RcuState* rcu = list->rcu;
+  if (rcu != 0) {
+    for (size_t i = 0; i < rcu->deferred_count; ++i) {
+      node_destroy(list, rcu->deferred[i]);
+    }
+    free(rcu->deferred);
+    pthread_mutex_destroy(&rcu->writer);
+    pthread_mutex_destroy(&rcu->readers_lock);
+    free(rcu);
+    list->rcu = 0;
+  }
+}
+
+// copies the elements of a list into new nodes of another list, or of the
+// same one, and links them in order before a given head, which has no nodes
+// yet. the links are set in the same pass, since a second pass over a long
+// list misses the cache again. with the slab allocator the nodes come out of
+// one chunk. returns false on an allocation failure, in which case nothing is
+// left allocated.
+static bool __copy_nodes(List to, const List from, Node* head) {
+  if (to->allocator.alloc == slab_alloc && !slab_reserve(to->allocator_state, from->size)) {
+    return false;
+  }
 
-ListStatus list_push_at(List list, size_t n, const ListData * data) {
-  if (n == 0) {
-    return list_push_front(list, data);
+  Node* last = head;
+  Node* iterator;
+  list_foreach(iterator, from) {
+    Node* node = node_create(to);
+    if (node == 0 || node_set(to, node, iterator->data) != NODE_SUCCESS) {
+      node_destroy(to, node);
+      while (last != head) {
+        Node* prev = last->prev;
+        node_destroy(to, last);
+        last = prev;
+      }
+      head->next = head->prev = head;
+      return false;
+    }
+    node->prev = last;
+    last->next = node;
+    last = node;
+  }
+  last->next = head;
+  head->prev = last;
+
+  return true;
+}
+
+// rebuilds the index of a list from its nodes.
+static bool __reindex(List list) {
+  index_clear(list->index);
+  if (!index_reserve(list->index, list->size)) {
+    return false;
+  }
+
+  Node* iterator;
+  list_foreach(iterator, list) {
+    index_insert(list->index, iterator);
+  }
+
+  return true;
+}
+
+// drops a reference to nodes shared with copy-on-write copies, and frees them
+// along with their head with the last one.
+static void __drop_shares(const List list, Node* head, size_t* shares) {
+  if (__atomic_sub_fetch(shares, 1, __ATOMIC_ACQ_REL) != 0) {
+    return;
+  }
+
+  free(shares);
+  for (Node* node = head->next; node != head;) {
+    Node* next = node->next;
+    node_destroy(list, node);
+    node = next;
+  }
+  free(head);
+}
+
+// called before a list changes. snapshots cannot change, and a list which
+// shares its nodes with copy-on-write copies gets nodes and elements of its
+// own. the iterators of the list in @keep, and its position for
+// list_get_next, move to the new nodes. others stay on the shared ones.
+static ListStatus __writable(List list, const ListIterator* keep, size_t count) {
+  if (list->read_only) {
+    return LIST_EINVAL;
+  }
+  if (list->shares == 0) {
+    return LIST_SUCCESS;
+  }
+  // the other lists have left.
+  if (__atomic_load_n(list->shares, __ATOMIC_ACQUIRE) == 1) {
+    free(list->shares);
+    list->shares = 0;
+    return LIST_SUCCESS;
+  }
+
+  // the index may be shared along with the nodes, so the new nodes go into
+  // a new one.
+  HashIndex* index = 0;
+  if (list->index != 0) {
+    index = index_create(list->index->hash);
+    if (index == 0 || !index_reserve(index, list->size)) {
+      index_destroy(index);
+      return LIST_NO_MEM;
+    }
+  }
+  Node* head = malloc(sizeof(*head));
+  if (head == 0) {
+    index_destroy(index);
+    return LIST_NO_MEM;
+  }
+  head->data = 0;
+  head->next = head->prev = head;
+  if (!__copy_nodes(list, list, head)) {
+    index_destroy(index);
+    free(head);
+    return LIST_NO_MEM;
   }
 
-  if (list == 0 || data == 0 || list->size < n) {
+  Node* old = list->head;
+  list->head = head;
+
+  Node* to = head;
+  Node* from = old;
+  do {
+    if (list->iterator == from) {
+      list->iterator = to;
+    }
+    for (size_t i = 0; i < count; ++i) {
+      if (keep[i] != 0 && keep[i]->list == list && keep[i]->node == from) {
+        keep[i]->node = to;
+      }
+    }
+    from = from->next;
+    to = to->next;
+  } while (from != old);
+
+  // the index has room for all the nodes already, so this cannot fail.
+  if (index != 0) {
+    index_destroy(list->index);
+    list->index = index;
+    __reindex(list);
+  }
+
+  __drop_shares(list, old, list->shares);
+  list->shares = 0;
+
+  return LIST_SUCCESS;
+}
+
+static ListStatus NodeStatus_to_ListStatus(NodeStatus status) {
+  switch (status) {
+  case NODE_SUCCESS:
+    return LIST_SUCCESS;
+  case NODE_NO_MEM:
+    return LIST_NO_MEM;
+  case NODE_EINVAL:
     return LIST_EINVAL;
+  default:
+    return LIST_SUCCESS;
   }
+}
 
-  Node * new = node_create();
+// creates a node with a copy of data and links it before a given node.
+static ListStatus __list_insert(List list, Node* position, const ListData* data) {
+  Node* new = node_create(list);
   if (new == 0) {
     return LIST_NO_MEM;
   }
 
-  NodeStatus res = node_set(new, data, list->data_copy);
+  NodeStatus res = node_set(list, new, data);
   if (res != NODE_SUCCESS) {
-    node_destroy(new, list->data_free);
+    node_destroy(list, new);
     return NodeStatus_to_ListStatus(res);
   }
 
+  if (__link_before(list, position, new) != LIST_SUCCESS) {
+    node_destroy(list, new);
+    return LIST_NO_MEM;
+  }
 
-  Node * iterator;
-  list_foreach(iterator, list) {
-    if (n-- == 1) {
-      break;
+  return LIST_SUCCESS;
+}
+
+// creates a node holding data itself and links it before a given node.
+// inline lists copy the data into the node and free it instead.
+static ListStatus __list_insert_take(List list, Node* position, ListData* data) {
+  if (list->elem_size != 0) {
+    ListStatus res = __list_insert(list, position, data);
+    if (res == LIST_SUCCESS) {
+      list->data_free(data);
     }
+    return res;
+  }
+
+  Node* new = node_create(list);
+  if (new == 0) {
+    return LIST_NO_MEM;
   }
 
-  new->next = iterator->next;
-  new->prev = iterator;
-  iterator->next = new;
-  iterator->next->prev = new;
-  ++list->size;
+  new->data = data;
+  if (__link_before(list, position, new) != LIST_SUCCESS) {
+    // the data still belongs to the caller.
+    node_free(list, new);
+    return LIST_NO_MEM;
+  }
 
   return LIST_SUCCESS;
 }
 
-ListStatus list_remove(List list, const ListData* data) {
-  if (list == 0 || data == 0) {
-    return LIST_EINVAL;
+// replaces the element of a node with data, freeing the old one. inline lists
+// copy data into the node instead.
+static void __node_replace(List list, Node* node, const ListData* data) {
+  // the index slot is found by the hash of the old element.
+  if (list->index != 0) {
+    index_remove(list->index, node);
   }
 
-  Node* iterator = 0;
-  if ((iterator = __find_node(list, data)) == 0) {
-    return LIST_NOT_FOUND;
+  if (list->elem_size != 0) {
+    memcpy(node->data, data, list->elem_size);
+  } else {
+    list->data_free(node->data);
+    node->data = (ListData*)data;
+  }
+
+  // the index had room for the node before, so this cannot fail.
+  if (list->index != 0) {
+    index_insert(list->index, node);
+  }
+}
+
+// unlinks a node and hands its data to the caller.
+// inline lists hand a heap copy of the element instead.
+static ListData* __list_extract(List list, Node* node) {
+  ListData* data = node->data;
+  if (list->elem_size != 0) {
+    data = malloc(list->elem_size);
+    if (data == 0) {
+      return 0;
+    }
+    memcpy(data, node->data, list->elem_size);
+  }
+
+  __unlink(list, node);
+  // the data goes to the caller, so readers are done with it first.
+  if (list->rcu != 0) {
+    __rcu_wait(list);
+  }
+  node_free(list, node);
+
+  return data;
+}
+
+// links a node right after (or before) a given node of a concurrent list,
+// which the caller keeps from being removed. the neighbour is read under the
+// lock of the link to it, so it cannot change until the node is linked.
+static void __concurrent_link(List list, Node* anchor, bool after, Node* node) {
+  // writers of RCU lists take turns.
+  if (list->rcu != 0) {
+    pthread_mutex_lock(&list->rcu->writer);
+    __link_before(list, after ? anchor->next : anchor, node);
+    pthread_mutex_unlock(&list->rcu->writer);
+    return;
+  }
+
+  LockSet set;
+  for (;;) {
+    if (after) {
+      __lockset_init(&set, __next_lock(list, anchor));
+      Node* next = anchor->next;
+      if (__lockset_try(&set, __prev_lock(list, next))) {
+        __link_before(list, next, node);
+        break;
+      }
+    } else {
+      __lockset_init(&set, __prev_lock(list, anchor));
+      if (__lockset_try(&set, __next_lock(list, anchor->prev))) {
+        __link_before(list, anchor, node);
+        break;
+      }
+    }
+  }
+  __lockset_release(&set);
+}
+
+// creates a node holding data, or a copy of it, outside of any lock and links
+// it next to a given node of a concurrent list.
+static ListStatus __concurrent_insert(List list, Node* anchor, bool after, const ListData* data, bool take) {
+  Node* new = node_create(list);
+  if (new == 0) {
+    return LIST_NO_MEM;
+  }
+
+  if (take) {
+    new->data = (ListData*)data;
+  } else {
+    NodeStatus res = node_set(list, new, data);
+    if (res != NODE_SUCCESS) {
+      node_destroy(list, new);
+      return NodeStatus_to_ListStatus(res);
+    }
+  }
+  __concurrent_link(list, anchor, after, new);
+
+  return LIST_SUCCESS;
+}
+
+// unlinks the first (or last) node of a concurrent list and hands its data
+// to the caller, or returns NULL pointer if the list is empty.
+static ListData* __concurrent_pop(List list, bool front) {
+  LockSet set;
+  Node* node;
+  if (list->rcu != 0) {
+    pthread_mutex_lock(&list->rcu->writer);
+    node = front ? list->head->next : list->head->prev;
+    if (node != list->head) {
+      __unlink(list, node);
+    }
+    pthread_mutex_unlock(&list->rcu->writer);
+    if (node == list->head) {
+      return 0;
+    }
+    // readers are done with the data before the caller gets it.
+    __rcu_wait(list);
+    ListData* data = node->data;
+    node_free(list, node);
+    return data;
+  }
+
+  for (;;) {
+    __lockset_init(&set, &list->locks[front ? FRONT_LOCK : BACK_LOCK]);
+    node = front ? list->head->next : list->head->prev;
+    if (node == list->head) {
+      node = 0;
+      break;
+    }
+    // once the node is locked, its other neighbour is stable too.
+    if (__lockset_try(&set, __node_lock(list, node)) &&
+        __lockset_try(&set, front ? __prev_lock(list, node->next) : __next_lock(list, node->prev))) {
+      __unlink(list, node);
+      break;
+    }
+  }
+  __lockset_release(&set);
+
+  if (node == 0) {
+    return 0;
+  }
+  ListData* data = node->data;
+  node_free(list, node);
+
+  return data;
+}
+
+// unlinks a node of a concurrent list, which the caller keeps from being
+// removed by others, and returns the node which followed it.
+static Node* __concurrent_unlink(List list, Node* node) {
+  if (list->rcu != 0) {
+    pthread_mutex_lock(&list->rcu->writer);
+    Node* next = node->next;
+    __unlink(list, node);
+    pthread_mutex_unlock(&list->rcu->writer);
+    return next;
+  }
+
+  LockSet set;
+  do {
+    __lockset_init(&set, __node_lock(list, node));
+  } while (!__lockset_try(&set, __next_lock(list, node->prev)) ||
+           !__lockset_try(&set, __prev_lock(list, node->next)));
+
+  Node* next = node->next;
+  __unlink(list, node);
+  __lockset_release(&set);
+
+  return next;
+}
+
+// inline elements are aligned to the largest power of 2 dividing their size,
+// which is at least as strict as their alignment requirement.
+static size_t __payload_offset(size_t elem_size) {
+  size_t align = elem_size & (~elem_size + 1);
+  if (align > sizeof(MaxAlign)) {
+    align = sizeof(MaxAlign);
+  }
+
+  return (sizeof(Node) + align - 1) / align * align;
+}
+
+static List __list_create(ListCopyFunction data_copy, ListFreeFunction data_free,
+                          ListCompareFunction data_compare, const ListAllocator * allocator,
+                          size_t elem_size) {
+  List new_list = malloc(sizeof(*new_list));
+  if (new_list == 0) {
+    return 0;
+  }
+
+  new_list->size = 0;
+  new_list->iterator = new_list->head = 0;
+  new_list->data_copy = data_copy;
+  new_list->data_free = data_free;
+  new_list->data_compare = data_compare;
+  new_list->allocator = *allocator;
+  new_list->allocator_state = 0;
+  new_list->elem_size = elem_size;
+  new_list->payload_offset = 0;
+  new_list->node_size = sizeof(Node);
+  new_list->index = 0;
+  new_list->locks = 0;
+  new_list->rcu = 0;
+  new_list->shares = 0;
+  new_list->read_only = false;
+  if (elem_size != 0) {
+    new_list->payload_offset = __payload_offset(elem_size);
+    new_list->node_size = new_list->payload_offset + elem_size;
+  }
+  if (allocator->create != 0) {
+    new_list->allocator_state = allocator->create(new_list->node_size, allocator->arg);
+    if (new_list->allocator_state == 0) {
+      free(new_list);
+      return 0;
+    }
+  }
+
+  // the head is not allocated with the node allocator, so releasing all the
+  // nodes at once leaves it intact.
+  new_list->head = malloc(sizeof(*new_list->head));
+  if (new_list->head == 0) {
+    if (allocator->destroy != 0) {
+      allocator->destroy(new_list->allocator_state);
+    }
+    free(new_list);
+    return 0;
+  }
+  new_list->head->next = new_list->head->prev = new_list->head;
+  // list head data is initialized to NULL pointer - this is very important,
+  // since the data of the head marks the edges of the list.
+  new_list->head->data = 0;
+  new_list->iterator = new_list->head;
+
+  return new_list;
+}
+
+List list_create(ListCopyFunction data_copy, ListFreeFunction data_free, ListCompareFunction data_compare) {
+  return list_create_with_allocator(data_copy, data_free, data_compare, &malloc_allocator);
+}
+
+List list_create_with_allocator(ListCopyFunction data_copy, ListFreeFunction data_free,
+                                ListCompareFunction data_compare, const ListAllocator * allocator) {
+  if (data_copy == 0 || data_free == 0 || data_compare == 0 || allocator == 0 ||
+      allocator->alloc == 0 || allocator->free == 0) {
+    return 0;
+  }
+
+  return __list_create(data_copy, data_free, data_compare, allocator, 0);
+}
+
+List list_create_inline(size_t elem_size, ListCompareFunction data_compare, const ListAllocator * allocator) {
+  if (elem_size == 0 || data_compare == 0 || allocator == 0 ||
+      allocator->alloc == 0 || allocator->free == 0) {
+    return 0;
+  }
+
+  // elements handed to the user are copies allocated with malloc.
+  return __list_create(0, free, data_compare, allocator, elem_size);
+}
+
+List list_create_concurrent(ListCopyFunction data_copy, ListFreeFunction data_free, ListCompareFunction data_compare) {
+  // nodes are allocated by several threads at once, which malloc allows.
+  List list = list_create(data_copy, data_free, data_compare);
+  if (list == 0) {
+    return 0;
+  }
+
+  if (__init_locks(list) != LIST_SUCCESS) {
+    list_destroy(list);
+    return 0;
+  }
+
+  return list;
+}
+
+List list_create_rcu(ListCopyFunction data_copy, ListFreeFunction data_free, ListCompareFunction data_compare) {
+  List list = list_create(data_copy, data_free, data_compare);
+  if (list == 0) {
+    return 0;
+  }
+
+  if (__init_rcu(list) != LIST_SUCCESS) {
+    list_destroy(list);
+    return 0;
+  }
+
+  return list;
+}
+
+ListData * list_get_first(const List list, ListIterator iterator) {
+  if (list == 0) {
+    return 0;
+  }
+
+  if (iterator == 0) {
+    // lists shared by several threads do not keep a position.
+    if (__is_shared(list)) {
+      ListData* data;
+      __next_of(list, list->head, &data);
+      return data;
+    }
+    list->iterator = __list_get_first(list);
+
+    // if list->iterator points to the head it's ok, since head's data is
+    // always NULL.
+    return list->iterator->data;
+  }
+
+  if (iterator->list != list) {
+    return 0;
+  }
+
+  ListData* data;
+  iterator->node = __next_of(list, list->head, &data);
+  if (iterator->node == list->head) {
+    iterator->start_edge = true;
+  } else {
+    iterator->start_edge = false;
+  }
+
+  return data;
+}
+
+ListData * list_get_last(const List list, ListIterator iterator) {
+  if (list == 0) {
+    return 0;
+  }
+
+  if (iterator == 0) {
+    if (__is_shared(list)) {
+      ListData* data;
+      __prev_of(list, list->head, &data);
+      return data;
+    }
+    list->iterator = __list_get_last(list);
+
+    // if list->iterator points to the head it's ok, since head's data is
+    // always NULL.
+    return list->iterator->data;
+  }
+
+  if (iterator->list != list) {
+    return 0;
+  }
+
+  ListData* data;
+  iterator->node = __prev_of(list, list->head, &data);
+  if (iterator->node == list->head) {
+    iterator->end_edge = true;
+  } else {
+    iterator->end_edge = false;
+  }
+
+  return data;
+}
+
+ListData * list_get_next(const List list, ListIterator iterator) {
+  // note that if we reached to end of list, the iterator does not advance,
+  // and we return NULL.
+  if (list == 0) {
+    return 0;
+  }
+
+  if (iterator == 0) {
+    if (__is_shared(list)) {
+      return 0;
+    }
+    list->iterator = list->iterator->next;
+
+    // if list->iterator points to the head it's ok, since head's data is
+    // always NULL.
+    return list->iterator->data;
+  }
+
+  // if the iterator is on an edge, we return NULL pointer.
+  if (list != iterator->list || iterator->end_edge) {
+    return 0;
+  }
+
+  ListData* data;
+  iterator->node = __next_of(list, iterator->node, &data);
+  if (iterator->node == list->head) {
+    iterator->end_edge = true;
+  }
+
+  return data;
+}
+
+ListData * list_get_prev(const List list, ListIterator iterator) {
+  // note that if we reached to start of list, the iterator does not regress,
+  // and we return NULL.
+  if (list == 0) {
+    return 0;
+  }
+
+  if (iterator == 0) {
+    if (__is_shared(list)) {
+      return 0;
+    }
+    list->iterator = list->iterator->prev;
+
+    // if list->iterator points to the head it's ok, since head's data is
+    // always NULL.
+    return list->iterator->data;
+  }
+
+  // if the iterator is on an edge, we return NULL pointer.
+  if (list != iterator->list || iterator->start_edge) {
+    return 0;
+  }
+
+  ListData* data;
+  iterator->node = __prev_of(list, iterator->node, &data);
+  if (iterator->node == list->head) {
+    iterator->start_edge = true;
+  }
+
+  return data;
+}
+
+ListData * list_cursor_first(const List list, ListCursor * cursor) {
+  if (list == 0 || cursor == 0) {
+    return 0;
+  }
+
+  Node* node = __atomic_load_n(&list->head->next, __ATOMIC_ACQUIRE);
+  cursor->node = node;
+
+  // head's data is always NULL.
+  return node->data;
+}
+
+ListData * list_cursor_last(const List list, ListCursor * cursor) {
+  if (list == 0 || cursor == 0) {
+    return 0;
+  }
+
+  Node* node = __atomic_load_n(&list->head->prev, __ATOMIC_ACQUIRE);
+  cursor->node = node;
+
+  return node->data;
+}
+
+ListData * list_cursor_next(const List list, ListCursor * cursor) {
+  // a cursor on the head passed one of the edges, and stays there.
+  if (list == 0 || cursor == 0 || cursor->node == 0 || cursor->node == list->head) {
+    return 0;
+  }
+
+  // readers of RCU lists see the node complete once they see the link to it.
+  Node* node = __atomic_load_n(&((Node*)cursor->node)->next, __ATOMIC_ACQUIRE);
+  cursor->node = node;
+
+  return node->data;
+}
+
+ListData * list_cursor_prev(const List list, ListCursor * cursor) {
+  if (list == 0 || cursor == 0 || cursor->node == 0 || cursor->node == list->head) {
+    return 0;
+  }
+
+  Node* node = __atomic_load_n(&((Node*)cursor->node)->prev, __ATOMIC_ACQUIRE);
+  cursor->node = node;
+
+  return node->data;
+}
+
+ListNode * list_head(const List list) {
+  return list == 0 ? 0 : list->head;
+}
+
+ListData * list_get_at(const List list, size_t n) {
+  if (list == 0) {
+    return 0;
+  }
+
+  __lock_readers(list);
+  ListData* data = (n < list->size) ? __node_at(list, n)->data : 0;
+  __unlock_readers(list);
+
+  return data;
+}
+
+ListStatus list_push_front(List list, const ListData* data) {
+  if (list == 0 || data == 0) {
+    return LIST_EINVAL;
+  }
+
+  ListStatus status = __writable(list, 0, 0);
+  if (status != LIST_SUCCESS) {
+    return status;
+  }
+
+  if (__is_shared(list)) {
+    return __concurrent_insert(list, list->head, true, data, false);
+  }
+
+  return __list_insert(list, __list_get_first(list), data);
+}
+
+ListStatus list_push_back(List list, const ListData* data) {
+  if (list == 0 || data == 0) {
+    return LIST_EINVAL;
+  }
+
+  ListStatus status = __writable(list, 0, 0);
+  if (status != LIST_SUCCESS) {
+    return status;
+  }
+
+  if (__is_shared(list)) {
+    return __concurrent_insert(list, list->head, false, data, false);
+  }
+
+  return __list_insert(list, list->head, data);
+}
+
+ListStatus list_push_after(List list, const ListIterator iterator, const ListData* data) {
+  if (list == 0 || data == 0 || iterator == 0 || list != iterator->list || iterator->end_edge) {
+    return LIST_EINVAL;
+  }
+
+  ListStatus status = __writable(list, &iterator, 1);
+  if (status != LIST_SUCCESS) {
+    return status;
+  }
+
+  if (__is_shared(list)) {
+    return __concurrent_insert(list, iterator->node, true, data, false);
+  }
+
+  return __list_insert(list, iterator->node->next, data);
+}
+
+ListStatus list_push_before(List list, const ListIterator iterator, const ListData* data) {
+  if (list == 0 || data == 0 || iterator == 0 || list != iterator->list || iterator->start_edge) {
+    return LIST_EINVAL;
+  }
+
+  ListStatus status = __writable(list, &iterator, 1);
+  if (status != LIST_SUCCESS) {
+    return status;
+  }
+
+  if (__is_shared(list)) {
+    return __concurrent_insert(list, iterator->node, false, data, false);
+  }
+
+  return __list_insert(list, iterator->node, data);
+}
+
+
+ListStatus list_push_at(List list, size_t n, const ListData * data) {
+  if (list == 0 || data == 0) {
+    return LIST_EINVAL;
+  }
+
+  ListStatus status = __writable(list, 0, 0);
+  if (status != LIST_SUCCESS) {
+    return status;
+  }
+
+  __lock_all(list);
+  status = (n <= list->size) ? __list_insert(list, __node_at(list, n), data) : LIST_EINVAL;
+  __unlock_all(list);
+
+  return status;
+}
+
+ListStatus list_push_front_take(List list, ListData* data) {
+  if (list == 0 || data == 0) {
+    return LIST_EINVAL;
+  }
+
+  ListStatus status = __writable(list, 0, 0);
+  if (status != LIST_SUCCESS) {
+    return status;
+  }
+
+  if (__is_shared(list)) {
+    return __concurrent_insert(list, list->head, true, data, true);
+  }
+
+  return __list_insert_take(list, __list_get_first(list), data);
+}
+
+ListStatus list_push_back_take(List list, ListData* data) {
+  if (list == 0 || data == 0) {
+    return LIST_EINVAL;
+  }
+
+  ListStatus status = __writable(list, 0, 0);
+  if (status != LIST_SUCCESS) {
+    return status;
+  }
+
+  if (__is_shared(list)) {
+    return __concurrent_insert(list, list->head, false, data, true);
+  }
+
+  return __list_insert_take(list, list->head, data);
+}
+
+ListStatus list_push_after_take(List list, const ListIterator iterator, ListData* data) {
+  if (list == 0 || data == 0 || iterator == 0 || list != iterator->list || iterator->end_edge) {
+    return LIST_EINVAL;
+  }
+
+  ListStatus status = __writable(list, &iterator, 1);
+  if (status != LIST_SUCCESS) {
+    return status;
+  }
+
+  if (__is_shared(list)) {
+    return __concurrent_insert(list, iterator->node, true, data, true);
+  }
+
+  return __list_insert_take(list, iterator->node->next, data);
+}
+
+ListStatus list_push_before_take(List list, const ListIterator iterator, ListData* data) {
+  if (list == 0 || data == 0 || iterator == 0 || list != iterator->list || iterator->start_edge) {
+    return LIST_EINVAL;
+  }
+
+  ListStatus status = __writable(list, &iterator, 1);
+  if (status != LIST_SUCCESS) {
+    return status;
+  }
+
+  if (__is_shared(list)) {
+    return __concurrent_insert(list, iterator->node, false, data, true);
+  }
+
+  return __list_insert_take(list, iterator->node, data);
+}
+
+ListStatus list_push_at_take(List list, size_t n, ListData * data) {
+  if (list == 0 || data == 0) {
+    return LIST_EINVAL;
+  }
+
+  ListStatus status = __writable(list, 0, 0);
+  if (status != LIST_SUCCESS) {
+    return status;
+  }
+
+  __lock_all(list);
+  status = (n <= list->size) ? __list_insert_take(list, __node_at(list, n), data) : LIST_EINVAL;
+  __unlock_all(list);
+
+  return status;
+}
+
+// links a chain of n new nodes at the back of the list. the nodes are
+// allocated before anything is linked, consecutively with the slab allocator,
+// and the chain is published at once to readers of RCU lists.
+static ListStatus __push_back_array(List list, ListData* const* data, size_t n, bool take) {
+  if (list->index != 0 && !index_reserve(list->index, n)) {
+    return LIST_NO_MEM;
+  }
+  if (list->allocator.alloc == slab_alloc && !slab_reserve(list->allocator_state, n)) {
+    return LIST_NO_MEM;
+  }
+
+  // inline lists copy the elements even when they take them.
+  bool adopt = take && list->elem_size == 0;
+  Node* chain = 0;
+  Node* last = 0;
+  for (size_t i = 0; i < n; ++i) {
+    Node* node = node_create(list);
+    if (node != 0 && adopt) {
+      node->data = data[i];
+    } else if (node != 0 && node_set(list, node, data[i]) != NODE_SUCCESS) {
+      node_destroy(list, node);
+      node = 0;
+    }
+    if (node == 0) {
+      // adopted elements still belong to the caller.
+      while (chain != 0) {
+        Node* next = chain->next;
+        if (adopt) {
+          node_free(list, chain);
+        } else {
+          node_destroy(list, chain);
+        }
+        chain = next;
+      }
+      return LIST_NO_MEM;
+    }
+
+    node->prev = last;
+    if (last == 0) {
+      chain = node;
+    } else {
+      last->next = node;
+    }
+    last = node;
+  }
+  if (chain == 0) {
+    return LIST_SUCCESS;
+  }
+
+  __lock_all(list);
+  Node* prev = list->head->prev;
+  chain->prev = prev;
+  last->next = list->head;
+  if (list->index != 0) {
+    for (Node* node = chain; node != list->head; node = node->next) {
+      index_insert(list->index, node);
+    }
+  }
+  __atomic_store_n(&prev->next, chain, __ATOMIC_RELEASE);
+  __atomic_store_n(&list->head->prev, last, __ATOMIC_RELEASE);
+  __add_size(list, (ptrdiff_t)n);
+  __unlock_all(list);
+
+  if (take && !adopt) {
+    for (size_t i = 0; i < n; ++i) {
+      list->data_free(data[i]);
+    }
+  }
+
+  return LIST_SUCCESS;
+}
+
+ListStatus list_push_back_array(List list, ListData* const* data, size_t n, bool take_ownership) {
+  if (list == 0 || (data == 0 && n != 0)) {
+    return LIST_EINVAL;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    if (data[i] == 0) {
+      return LIST_EINVAL;
+    }
+  }
+
+  ListStatus status = __writable(list, 0, 0);
+  if (status != LIST_SUCCESS) {
+    return status;
+  }
+
+  return __push_back_array(list, data, n, take_ownership);
+}
+
+List list_create_from_array(ListCopyFunction data_copy, ListFreeFunction data_free,
+                            ListCompareFunction data_compare, const ListAllocator * allocator,
+                            ListData* const* data, size_t n, bool take_ownership) {
+  List list = list_create_with_allocator(data_copy, data_free, data_compare, allocator);
+  if (list == 0) {
+    return 0;
+  }
+
+  if (list_push_back_array(list, data, n, take_ownership) != LIST_SUCCESS) {
+    list_destroy(list);
+    return 0;
+  }
+
+  return list;
+}
+
+size_t list_to_array(const List list, ListData** out, size_t n) {
+  if (list == 0 || (out == 0 && n != 0)) {
+    return 0;
+  }
+
+  size_t count = 0;
+  __lock_readers(list);
+  for (Node* node = __atomic_load_n(&list->head->next, __ATOMIC_ACQUIRE);
+       node != list->head && count < n;
+       node = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE)) {
+    out[count++] = node->data;
+  }
+  __unlock_readers(list);
+
+  return count;
+}
+
+ListStatus list_remove(List list, const ListData* data) {
+  if (list == 0 || data == 0) {
+    return LIST_EINVAL;
+  }
+
+  ListStatus status = __writable(list, 0, 0);
+  if (status != LIST_SUCCESS) {
+    return status;
+  }
+
+  // __find_node returns the head if the data does not exist in the list.
+  __lock_all(list);
+  Node* iterator = __find_node(list, data);
+  if (iterator == list->head) {
+    __unlock_all(list);
+    return LIST_NOT_FOUND;
+  }
+
+  __unlink(list, iterator);
+  __unlock_all(list);
+  __dispose(list, iterator);
+
+  return LIST_SUCCESS;
+}
+
+ListData * list_remove_take(List list, const ListData* data) {
+  if (list == 0 || data == 0) {
+    return 0;
+  }
+
+  if (__writable(list, 0, 0) != LIST_SUCCESS) {
+    return 0;
+  }
+
+  __lock_all(list);
+  Node* iterator = __find_node(list, data);
+  ListData* found = (iterator != list->head) ? __list_extract(list, iterator) : 0;
+  __unlock_all(list);
+
+  return found;
+}
+
+ListData * list_pop_front(List list) {
+  if (list != 0 && __writable(list, 0, 0) != LIST_SUCCESS) {
+    return 0;
+  }
+
+  if (list != 0 && __is_shared(list)) {
+    return __concurrent_pop(list, true);
+  }
+
+  if (list == 0 || list->size == 0) {
+    return 0;
+  }
+
+  return __list_extract(list, __list_get_first(list));
+}
+
+ListData * list_pop_back(List list) {
+  if (list != 0 && __writable(list, 0, 0) != LIST_SUCCESS) {
+    return 0;
+  }
+
+  if (list != 0 && __is_shared(list)) {
+    return __concurrent_pop(list, false);
+  }
+
+  if (list == 0 || list->size == 0) {
+    return 0;
+  }
+
+  return __list_extract(list, __list_get_last(list));
+}
+
+ListStatus list_remove_at(List list, size_t n) {
+  if (list == 0) {
+    return LIST_EINVAL;
+  }
+
+  ListStatus status = __writable(list, 0, 0);
+  if (status != LIST_SUCCESS) {
+    return status;
+  }
+
+  __lock_all(list);
+  if (n >= list->size) {
+    __unlock_all(list);
+    return LIST_EINVAL;
+  }
+
+  Node * iterator = __node_at(list, n);
+  __unlink(list, iterator);
+  __unlock_all(list);
+  __dispose(list, iterator);
+
+  return LIST_SUCCESS;
+}
+
+ListData * list_remove_at_take(List list, size_t n) {
+  if (list == 0) {
+    return 0;
+  }
+
+  if (__writable(list, 0, 0) != LIST_SUCCESS) {
+    return 0;
+  }
+
+  __lock_all(list);
+  ListData* data = (n < list->size) ? __list_extract(list, __node_at(list, n)) : 0;
+  __unlock_all(list);
+
+  return data;
+}
+
+ListStatus list_remove_iterator(List list, ListIterator iterator) {
+  if (list == 0 || iterator == 0 || list != iterator->list) {
+    return LIST_EINVAL;
+  }
+
+  ListStatus status = __writable(list, &iterator, 1);
+  if (status != LIST_SUCCESS) {
+    return status;
+  }
+
+  Node * next;
+  if (__is_shared(list)) {
+    next = __concurrent_unlink(list, iterator->node);
+  } else {
+    next = iterator->node->next;
+    __unlink(list, iterator->node);
+  }
+  __dispose(list, iterator->node);
+
+  // fix the iterator to point to next element
+  iterator->node = next;
+  if (iterator->node == list->head) {
+    iterator->end_edge = true;
+  }
+
+  return LIST_SUCCESS;
+}
+
+// unlinks the nodes whose elements match in a single pass under the writer
+// locks, and frees them once the locks are released. readers of RCU lists
+// may still follow the links of the unlinked nodes, so those are deferred
+// one by one instead of being chained.
+static size_t __remove_if(List list, ListPredicateFunction pred, void* ctx) {
+  Node* removed = 0;
+  size_t count = 0;
+  __lock_all(list);
+  Node* node = list->head->next;
+  while (node != list->head) {
+    Node* next = node->next;
+    if (pred(node->data, ctx)) {
+      __unlink(list, node);
+      if (list->rcu != 0) {
+        __rcu_defer(list, node);
+      } else {
+        node->next = removed;
+        removed = node;
+      }
+      ++count;
+    }
+    node = next;
+  }
+  __unlock_all(list);
+
+  while (removed != 0) {
+    Node* next = removed->next;
+    node_destroy(list, removed);
+    removed = next;
+  }
+
+  return count;
+}
+
+size_t list_remove_if(List list, ListPredicateFunction pred, void* ctx) {
+  if (list == 0 || pred == 0 || __writable(list, 0, 0) != LIST_SUCCESS) {
+    return 0;
+  }
+
+  return __remove_if(list, pred, ctx);
+}
+
+typedef struct {
+  ListCompareFunction data_compare;
+  const ListData* data;
+} EqualTo;
+
+static bool __equal_to(const ListData* element, void* ctx) {
+  const EqualTo* equal_to = ctx;
+  return equal_to->data_compare(equal_to->data, element) == 0;
+}
+
+size_t list_remove_all(List list, const ListData* data) {
+  if (list == 0 || data == 0) {
+    return 0;
+  }
+
+  // the index tells right away when there is nothing to remove.
+  bool unique;
+  if (list->index != 0 && index_find(list->index, list->data_compare, data, &unique) == 0) {
+    return 0;
+  }
+
+  EqualTo equal_to = { list->data_compare, data };
+  return list_remove_if(list, __equal_to, &equal_to);
+}
+
+// detaches all the nodes from a list into a chain, leaving it empty. the
+// caller holds all the locks. readers of an RCU list may be on its nodes, so
+// it is emptied first and the chain is only cut after a grace period.
+static Node* __detach_all(List list) {
+  __atomic_store_n(&list->size, 0, __ATOMIC_RELAXED);
+  if (list->rcu == 0) {
+    return __detach_chain(list);
+  }
+
+  Node* first = list->head->next;
+  Node* last = list->head->prev;
+  __atomic_store_n(&list->head->next, list->head, __ATOMIC_RELEASE);
+  __atomic_store_n(&list->head->prev, list->head, __ATOMIC_RELEASE);
+  __rcu_wait(list);
+  if (first == list->head) {
+    return 0;
+  }
+
+  last->next = 0;
+  return first;
+}
+
+static void __rcu_clear(List list) {
+  pthread_mutex_lock(&list->rcu->writer);
+  Node* chain = __detach_all(list);
+  while (chain != 0) {
+    Node* next = chain->next;
+    node_destroy(list, chain);
+    chain = next;
+  }
+  pthread_mutex_unlock(&list->rcu->writer);
+}
+
+// empties a list which shares its nodes with copy-on-write copies, leaving
+// the nodes to them.
+static bool __leave_shares(List list) {
+  Node* head = malloc(sizeof(*head));
+  HashIndex* index = (list->index != 0) ? index_create(list->index->hash) : 0;
+  if (head == 0 || (list->index != 0 && index == 0)) {
+    index_destroy(index);
+    free(head);
+    return false;
+  }
+
+  // the index may be shared along with the nodes.
+  index_destroy(list->index);
+  list->index = index;
+  __drop_shares(list, list->head, list->shares);
+  head->data = 0;
+  head->next = head->prev = head;
+  list->head = list->iterator = head;
+  list->shares = 0;
+  list->size = 0;
+
+  return true;
+}
+
+static void __list_clear(List list) {
+  if (list->rcu != 0) {
+    __rcu_clear(list);
+  } else if (list->shares != 0) {
+    if (!__leave_shares(list) && __writable(list, 0, 0) == LIST_SUCCESS) {
+      __list_clear(list);
+    }
+  } else {
+    __lock_all(list);
+    if (list->allocator.release != 0) {
+      // only the data needs to be freed one by one, the allocator frees all
+      // the nodes at once. inline elements need not be freed at all.
+      Node* iterator;
+      if (list->elem_size == 0) {
+        list_foreach(iterator, list) {
+          list->data_free(iterator->data);
+        }
+      }
+      list->allocator.release(list->allocator_state);
+    } else {
+      Node *to_delete;
+      list->iterator = list->head->next;
+      while (list->iterator != list->head) {
+        to_delete = list->iterator;
+        list->iterator = list->iterator->next;
+        node_destroy(list, to_delete);
+      }
+    }
+
+    if (list->index != 0) {
+      index_clear(list->index);
+    }
+
+    // finished freeing. now fix the list to empty.
+    list->head->next = list->head->prev = list->head;
+    list->size = 0;
+    list->iterator = list->head;
+    __unlock_all(list);
+  }
+}
+
+// snapshots stay as they are, until they are destroyed.
+void list_clear(List list) {
+  if (list != 0 && !list->read_only) {
+    __list_clear(list);
+  }
+}
+
+void list_destroy(List list) {
+  if (list != 0) {
+    if (list->shares != 0) {
+      // the head goes along with the shared nodes, and the index is dropped
+      // first, as the last list left may then change it.
+      index_destroy(list->index);
+      __drop_shares(list, list->head, list->shares);
+    } else {
+      __list_clear(list);
+      free(list->head);
+      index_destroy(list->index);
+    }
+    __destroy_locks(list);
+    __destroy_rcu(list);
+    if (list->allocator.destroy != 0) {
+      list->allocator.destroy(list->allocator_state);
+    }
+    free(list);
+  }
+}
+
+// frees the nodes of a chain, without their data, back to a given allocator
+// state, and destroys the state.
+static void __free_chain(const List list, void* state, Node* chain) {
+  if (list->allocator.release != 0) {
+    list->allocator.release(state);
+  } else {
+    while (chain != 0) {
+      Node* next = chain->next;
+      list->allocator.free(state, chain);
+      chain = next;
+    }
+  }
+
+  if (list->allocator.destroy != 0) {
+    list->allocator.destroy(state);
+  }
+}
+
+// the nodes are reallocated in list order from a fresh allocator state, so
+// that with a chunked allocator (e.g. the slab allocator) consecutive
+// elements end up consecutive in memory.
+static ListStatus __list_compact(List list) {
+  void* state = 0;
+  if (list->allocator.create != 0) {
+    state = list->allocator.create(list->node_size, list->allocator.arg);
+    if (state == 0) {
+      return LIST_NO_MEM;
+    }
+  }
+
+  Node* chain = 0;
+  Node** tail = &chain;
+  Node* iterator;
+  list_foreach(iterator, list) {
+    Node* node = list->allocator.alloc(state, list->node_size);
+    if (node == 0) {
+      *tail = 0;
+      __free_chain(list, state, chain);
+      return LIST_NO_MEM;
+    }
+
+    memcpy(node, iterator, list->node_size);
+    if (list->elem_size != 0) {
+      node->data = node_payload(list, node);
+    }
+    *tail = node;
+    tail = &node->next;
+  }
+  *tail = 0;
+
+  __free_chain(list, list->allocator_state, __detach_chain(list));
+  list->allocator_state = state;
+  __attach_chain(list, chain);
+
+  // the index has room for all the nodes already, so this cannot fail.
+  if (list->index != 0) {
+    __reindex(list);
+  }
+
+  return LIST_SUCCESS;
+}
+
+ListStatus list_compact(List list) {
+  // readers of RCU lists may be on the old nodes.
+  if (list == 0 || list->rcu != 0) {
+    return LIST_EINVAL;
+  }
+
+  ListStatus status = __writable(list, 0, 0);
+  if (status != LIST_SUCCESS) {
+    return status;
+  }
+
+  __lock_all(list);
+  status = __list_compact(list);
+  __unlock_all(list);
+
+  return status;
+}
+
+static List __list_copy(const List list) {
+  List new = __list_create(list->data_copy, list->data_free, list->data_compare,
+                           &list->allocator, list->elem_size);
+  if (new == 0) {
+    return 0;
+  }
+
+  if (list->index != 0 && list_set_hash_index(new, list->index->hash) != LIST_SUCCESS) {
+    list_destroy(new);
+    return 0;
+  }
+
+  // nobody else has the copy yet, so it is filled before it gets its locks.
+  if (!__copy_nodes(new, list, new->head)) {
+    list_destroy(new);
+    return 0;
+  }
+  new->size = list->size;
+  if (new->index != 0 && !__reindex(new)) {
+    list_destroy(new);
+    return 0;
+  }
+
+  if (list->locks != 0 && __init_locks(new) != LIST_SUCCESS) {
+    list_destroy(new);
+    return 0;
+  }
+  if (list->rcu != 0 && __init_rcu(new) != LIST_SUCCESS) {
+    list_destroy(new);
+    return 0;
+  }
+
+  return new;
+}
+
+List list_copy(const List list) {
+  if (list == 0) {
+    return 0;
+  }
+
+  __lock_readers(list);
+  List new = __list_copy(list);
+  __unlock_readers(list);
+
+  return new;
+}
+
+List list_copy_cow(const List list) {
+  if (list == 0) {
+    return 0;
+  }
+  // other threads change the nodes of shared lists in place, and nodes from
+  // an allocator state would not outlive the list which owns it.
+  if (__is_shared(list) || list->allocator.create != 0) {
+    return list_copy(list);
+  }
+
+  List new = __list_create(list->data_copy, list->data_free, list->data_compare,
+                           &list->allocator, list->elem_size);
+  if (new == 0) {
+    return 0;
+  }
+  if (list->shares == 0) {
+    list->shares = malloc(sizeof(*list->shares));
+    if (list->shares == 0) {
+      list_destroy(new);
+      return 0;
+    }
+    *list->shares = 1;
+  }
+
+  __atomic_add_fetch(list->shares, 1, __ATOMIC_RELAXED);
+  free(new->head);
+  new->head = new->iterator = list->head;
+  new->size = list->size;
+  new->shares = list->shares;
+  new->index = index_share(list->index);
+
+  return new;
+}
+
+List list_snapshot(const List list) {
+  if (list == 0) {
+    return 0;
+  }
+
+  // the copy of a shared list is made under its writer locks, so that it
+  // holds the list as it was at one point in time.
+  List snapshot;
+  if (__is_shared(list)) {
+    __lock_all(list);
+    snapshot = __list_copy(list);
+    __unlock_all(list);
+  } else {
+    snapshot = list_copy_cow(list);
+  }
+
+  if (snapshot != 0) {
+    snapshot->read_only = true;
+  }
+
+  return snapshot;
+}
+
+ListStatus list_set_hash_index(List list, ListHashFunction hash) {
+  // the index would be shared by operations which run at the same time.
+  if (list == 0 || __is_shared(list)) {
+    return LIST_EINVAL;
+  }
+
+  index_destroy(list->index);
+  list->index = 0;
+  if (hash == 0) {
+    return LIST_SUCCESS;
+  }
+
+  HashIndex* index = index_create(hash);
+  if (index == 0) {
+    return LIST_NO_MEM;
+  }
+
+  Node* iterator;
+  list_foreach(iterator, list) {
+    if (!index_insert(index, iterator)) {
+      index_destroy(index);
+      return LIST_NO_MEM;
+    }
+  }
+  list->index = index;
+
+  return LIST_SUCCESS;
+}
+
+ListData const * list_find(const List list, const ListData * data) {
+  if (list == 0 || data == 0) {
+    return 0;
+  }
+
+  __lock_readers(list);
+  ListData* found = __find_node(list, data)->data;
+  __unlock_readers(list);
+
+  return found;
+}
+
+
+// merges two sorted chains. on equal elements, those of @a come first, which
+// keeps the sort stable as long as @a holds the earlier elements.
+static Node* __merge(Node* a, Node* b, ListCompareFunction data_compare) {
+  Node* merged = 0;
+  Node** tail = &merged;
+  while (a != 0 && b != 0) {
+    if (data_compare(a->data, b->data) <= 0) {
+      *tail = a;
+      a = a->next;
+    } else {
+      *tail = b;
+      b = b->next;
+    }
+    tail = &(*tail)->next;
+  }
+  *tail = (a != 0) ? a : b;
+
+  return merged;
+}
+
+#define SORT_BINS 64
+
+// bottom-up merge sort of a chain. bins[k] holds a sorted run of 2^k nodes,
+// so a fixed number of bins is enough for any list that fits in memory.
+static Node* __sort_chain(Node* chain, ListCompareFunction data_compare) {
+  Node* bins[SORT_BINS] = { 0 };
+  size_t max_bin = 0;
+  while (chain != 0) {
+    Node* run = chain;
+    chain = chain->next;
+    run->next = 0;
+
+    // bins hold earlier nodes than the run, so they go first when merged.
+    size_t k;
+    for (k = 0; k < SORT_BINS - 1 && bins[k] != 0; ++k) {
+      run = __merge(bins[k], run, data_compare);
+      bins[k] = 0;
+    }
+    bins[k] = (bins[k] != 0) ? __merge(bins[k], run, data_compare) : run;
+    if (k > max_bin) {
+      max_bin = k;
+    }
+  }
+
+  Node* sorted = 0;
+  for (size_t k = 0; k <= max_bin; ++k) {
+    sorted = __merge(bins[k], sorted, data_compare);
+  }
+
+  return sorted;
+}
+
+// the nodes are merge-sorted by relinking them in place, so no element is
+// copied and no memory is allocated. nothing can fail, so the list is never
+// left in a partial state.
+static void __list_sort(List list) {
+  __attach_chain(list, __sort_chain(__detach_chain(list), list->data_compare));
+}
+
+ListStatus list_sort(List list) {
+  // sorting relinks the nodes in place, which readers of RCU lists would see.
+  if (list == 0 || list->rcu != 0) {
+    return LIST_EINVAL;
+  }
+
+  ListStatus status = __writable(list, 0, 0);
+  if (status != LIST_SUCCESS) {
+    return status;
+  }
+
+  __lock_all(list);
+  __list_sort(list);
+  __unlock_all(list);
+
+  return LIST_SUCCESS;
+}
+
+// lists are split into runs of at least this many nodes for parallel sort,
+// smaller runs are not worth a thread.
+#define PARALLEL_SORT_MIN_RUN 1024
+
+typedef struct {
+  Node* chain;
+  Node* other;   // the chain merged into @chain by __merge_task
+  ListCompareFunction data_compare;
+  pthread_t thread;
+  bool spawned;
+} SortTask;
+
+static void* __sort_task(void* arg) {
+  SortTask* task = arg;
+  task->chain = __sort_chain(task->chain, task->data_compare);
+  return 0;
+}
+
+static void* __merge_task(void* arg) {
+  SortTask* task = arg;
+  task->chain = __merge(task->chain, task->other, task->data_compare);
+  return 0;
+}
+
+// runs a task per element of @tasks, the first one on the calling thread. if
+// a thread cannot be created, its task runs on the calling thread as well.
+static void __run_parallel(void* (*run)(void*), SortTask* tasks, size_t count) {
+  for (size_t i = 1; i < count; ++i) {
+    tasks[i].spawned = (pthread_create(&tasks[i].thread, 0, run, &tasks[i]) == 0);
+  }
+
+  run(&tasks[0]);
+  for (size_t i = 1; i < count; ++i) {
+    if (tasks[i].spawned) {
+      pthread_join(tasks[i].thread, 0);
+    } else {
+      run(&tasks[i]);
+    }
+  }
+}
+
+// the list is split into consecutive runs which are sorted concurrently, and
+// then adjacent runs are merged pairwise, concurrently, until one is left.
+// since the earlier run always goes first in a merge, the result is stable
+// and identical to list_sort.
+static void __list_sort_parallel(List list, unsigned threads) {
+  size_t runs = list->size / PARALLEL_SORT_MIN_RUN;
+  if (runs > threads) {
+    runs = threads;
+  }
+  if (runs <= 1) {
+    __list_sort(list);
+    return;
+  }
+
+  SortTask* tasks = malloc(sizeof(*tasks) * runs);
+  if (tasks == 0) {
+    __list_sort(list);
+    return;
+  }
+
+  size_t run_size = list->size / runs;
+  Node* chain = __detach_chain(list);
+  for (size_t i = 0; i < runs; ++i) {
+    tasks[i].chain = chain;
+    tasks[i].data_compare = list->data_compare;
+    if (i == runs - 1) {
+      break;
+    }
+
+    for (size_t j = 1; j < run_size; ++j) {
+      chain = chain->next;
+    }
+    Node* next = chain->next;
+    chain->next = 0;
+    chain = next;
+  }
+
+  __run_parallel(__sort_task, tasks, runs);
+
+  while (runs > 1) {
+    size_t pairs = runs / 2;
+    for (size_t i = 0; i < pairs; ++i) {
+      tasks[i].chain = tasks[2 * i].chain;
+      tasks[i].other = tasks[2 * i + 1].chain;
+    }
+    __run_parallel(__merge_task, tasks, pairs);
+
+    // an odd run out waits for the next round.
+    if (runs % 2 != 0) {
+      tasks[pairs].chain = tasks[runs - 1].chain;
+    }
+    runs = pairs + runs % 2;
+  }
+
+  __attach_chain(list, tasks[0].chain);
+  free(tasks);
+}
+
+ListStatus list_sort_parallel(List list, unsigned threads) {
+  if (list == 0 || threads == 0 || list->rcu != 0) {
+    return LIST_EINVAL;
+  }
+
+  ListStatus status = __writable(list, 0, 0);
+  if (status != LIST_SUCCESS) {
+    return status;
+  }
+
+  __lock_all(list);
+  __list_sort_parallel(list, threads);
+  __unlock_all(list);
+
+  return LIST_SUCCESS;
+}
+
+typedef struct {
+  uint64_t key;
+  Node* node;
+} KeyedNode;
+
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_PASSES (64 / RADIX_BITS)
+
+// the keys are sorted with an LSD radix sort, which is stable, and then the
+// nodes are relinked in the order of their keys. runs of equal keys are
+// sorted with the compare function, like list_sort.
+static ListStatus __list_sort_by_key(List list, ListKeyFunction key) {
+  size_t size = list->size;
+  if (size <= 1) {
+    return LIST_SUCCESS;
+  }
+
+  KeyedNode* keys = malloc(sizeof(*keys) * size);
+  KeyedNode* buffer = malloc(sizeof(*buffer) * size);
+  size_t (*counts)[RADIX_BUCKETS] = calloc(RADIX_PASSES, sizeof(*counts));
+  if (keys == 0 || buffer == 0 || counts == 0) {
+    free(keys);
+    free(buffer);
+    free(counts);
+    return LIST_NO_MEM;
+  }
+
+  // the histograms of all the passes are gathered at once.
+  Node* iterator;
+  size_t i = 0;
+  list_foreach(iterator, list) {
+    keys[i].key = key(iterator->data);
+    keys[i].node = iterator;
+    for (size_t pass = 0; pass < RADIX_PASSES; ++pass) {
+      ++counts[pass][(keys[i].key >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1)];
+    }
+    ++i;
+  }
+
+  for (size_t pass = 0; pass < RADIX_PASSES; ++pass) {
+    size_t shift = pass * RADIX_BITS;
+    // a pass where all keys share the same digit changes nothing.
+    if (counts[pass][(keys[0].key >> shift) & (RADIX_BUCKETS - 1)] == size) {
+      continue;
+    }
+
+    size_t offset = 0;
+    for (size_t bucket = 0; bucket < RADIX_BUCKETS; ++bucket) {
+      size_t count = counts[pass][bucket];
+      counts[pass][bucket] = offset;
+      offset += count;
+    }
+    for (i = 0; i < size; ++i) {
+      buffer[counts[pass][(keys[i].key >> shift) & (RADIX_BUCKETS - 1)]++] = keys[i];
+    }
+
+    KeyedNode* tmp = keys;
+    keys = buffer;
+    buffer = tmp;
+  }
+
+  __detach_chain(list);
+  Node* sorted = 0;
+  Node** tail = &sorted;
+  for (i = 0; i < size; ) {
+    size_t end = i + 1;
+    while (end < size && keys[end].key == keys[i].key) {
+      ++end;
+    }
+
+    Node* run = 0;
+    Node** run_tail = &run;
+    for (size_t j = i; j < end; ++j) {
+      *run_tail = keys[j].node;
+      run_tail = &keys[j].node->next;
+    }
+    *run_tail = 0;
+    if (end - i > 1) {
+      run = __sort_chain(run, list->data_compare);
+    }
+
+    *tail = run;
+    while (*tail != 0) {
+      tail = &(*tail)->next;
+    }
+    i = end;
+  }
+
+  __attach_chain(list, sorted);
+
+  free(keys);
+  free(buffer);
+  free(counts);
+
+  return LIST_SUCCESS;
+}
+
+ListStatus list_sort_by_key(List list, ListKeyFunction key) {
+  if (list == 0 || key == 0 || list->rcu != 0) {
+    return LIST_EINVAL;
+  }
+
+  ListStatus status = __writable(list, 0, 0);
+  if (status != LIST_SUCCESS) {
+    return status;
+  }
+
+  __lock_all(list);
+  status = __list_sort_by_key(list, key);
+  __unlock_all(list);
+
+  return status;
+}
+
+// nodes move from one list to another as they are when both allocate them
+// without a state of their own, like malloc does.
+static bool __shares_nodes(const List a, const List b) {
+  return a == b || (a->allocator.alloc == b->allocator.alloc && a->allocator.free == b->allocator.free &&
+                    a->allocator.create == 0 && b->allocator.create == 0);
+}
+
+// lists between which nodes may move, since they free them and their
+// elements the same way.
+static bool __can_move(const List dst, const List src) {
+  return !__is_shared(dst) && !__is_shared(src) && __shares_nodes(dst, src) &&
+         dst->elem_size == src->elem_size && dst->data_free == src->data_free;
+}
+
+// counts the nodes from first up to last, or returns false if last does not
+// follow first.
+static bool __count_range(const List list, Node* first, Node* last, size_t* count) {
+  *count = 0;
+  for (Node* node = first; node != last; node = node->next) {
+    if (node == list->head) {
+      return false;
+    }
+    ++*count;
+  }
+
+  return true;
+}
+
+// whether a node is after first and before last, which follows first.
+static bool __in_range(const Node* node, Node* first, Node* last) {
+  if (first == last) {
+    return false;
+  }
+
+  for (Node* inner = first->next; inner != last; inner = inner->next) {
+    if (inner == node) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// moves count nodes from first up to last (excluded) out of src, and links
+// them before position in dst. returns the first node in dst, or NULL pointer
+// if the hash index of dst could not grow, in which case nothing moves.
+static Node* __move_range(List dst, Node* position, List src, Node* first, Node* last, size_t count) {
+  if (dst->index != 0 && dst != src) {
+    Node* node = first;
+    for (size_t i = 0; i < count; ++i, node = node->next) {
+      if (!index_insert(dst->index, node)) {
+        for (Node* added = first; added != node; added = added->next) {
+          index_remove(dst->index, added);
+        }
+        return 0;
+      }
+    }
+  }
+
+  // nothing fails from here on.
+  if (src->index != 0 && dst != src) {
+    Node* node = first;
+    for (size_t i = 0; i < count; ++i, node = node->next) {
+      index_remove(src->index, node);
+    }
+  }
+  Node* tail = last->prev;
+  first->prev->next = last;
+  last->prev = first->prev;
+  src->size -= count;
+  src->iterator = src->head;
+
+  first->prev = position->prev;
+  position->prev->next = first;
+  tail->next = position;
+  position->prev = tail;
+  dst->size += count;
+
+  return first;
+}
+
+ListStatus list_splice(List dst, const ListIterator position, List src, ListIterator first, const ListIterator last) {
+  if (dst == 0 || src == 0 || first == 0 || first->list != src ||
+      (position != 0 && position->list != dst) || (last != 0 && last->list != src) ||
+      !__can_move(dst, src)) {
+    return LIST_EINVAL;
+  }
+
+  const ListIterator keep[] = { position, first, last };
+  ListStatus status = __writable(dst, keep, 3);
+  if (status != LIST_SUCCESS) {
+    return status;
+  }
+  status = __writable(src, keep, 3);
+  if (status != LIST_SUCCESS) {
+    return status;
+  }
+
+  Node* from = first->node;
+  Node* to = (last != 0) ? last->node : src->head;
+  // an iterator on the start edge inserts at the front, and none at the back.
+  Node* before = (position != 0) ? position->node : dst->head;
+  if (position != 0 && position->start_edge) {
+    before = dst->head->next;
+  }
+  if (from == src->head) {
+    // an iterator on the start edge is on the head, before the first node.
+    if (!first->start_edge) {
+      return (to == src->head) ? LIST_SUCCESS : LIST_EINVAL;
+    }
+    from = from->next;
+  }
+
+  // moving a range within its list keeps the size, so nothing is counted,
+  // but the range is walked to check that it is one, and that @position is
+  // not inside it.
+  size_t count = 0;
+  if (dst != src) {
+    if (!__count_range(src, from, to, &count)) {
+      return LIST_EINVAL;
+    }
+    if (count == 0) {
+      return LIST_SUCCESS;
+    }
+  } else if (!__count_range(src, from, to, &count) || __in_range(before, from, to)) {
+    return LIST_EINVAL;
+  } else if (from == to || before == from || before == to) {
+    return LIST_SUCCESS;
+  } else {
+    // the nodes are relinked as they are, so only the links change.
+    Node* tail = to->prev;
+    from->prev->next = to;
+    to->prev = from->prev;
+    from->prev = before->prev;
+    before->prev->next = from;
+    tail->next = before;
+    before->prev = tail;
+    src->iterator = src->head;
+    first->node = from;
+    first->start_edge = first->end_edge = false;
+    return LIST_SUCCESS;
+  }
+
+  Node* moved = __move_range(dst, before, src, from, to, count);
+  if (moved == 0) {
+    return LIST_NO_MEM;
+  }
+  first->list = dst;
+  first->node = moved;
+  first->start_edge = first->end_edge = false;
+
+  return LIST_SUCCESS;
+}
+
+ListStatus list_concat(List dst, List src) {
+  if (dst == 0 || src == 0 || dst == src || !__can_move(dst, src)) {
+    return LIST_EINVAL;
+  }
+
+  if (src->size == 0) {
+    return LIST_SUCCESS;
+  }
+
+  ListStatus status = __writable(dst, 0, 0);
+  if (status != LIST_SUCCESS) {
+    return status;
+  }
+  status = __writable(src, 0, 0);
+  if (status != LIST_SUCCESS) {
+    return status;
+  }
+
+  return __move_range(dst, dst->head, src, src->head->next, src->head, src->size) != 0 ?
+         LIST_SUCCESS : LIST_NO_MEM;
+}
+
+List list_split_at(List list, ListIterator iterator) {
+  // the new list allocates nodes from a state of its own, if the allocator
+  // has one, and then they cannot move into it.
+  if (list == 0 || iterator == 0 || iterator->list != list || __is_shared(list) ||
+      list->allocator.create != 0) {
+    return 0;
+  }
+
+  if (__writable(list, &iterator, 1) != LIST_SUCCESS) {
+    return 0;
+  }
+
+  List new = __list_create(list->data_copy, list->data_free, list->data_compare,
+                           &list->allocator, list->elem_size);
+  if (new == 0) {
+    return 0;
+  }
+  if (list->index != 0 && list_set_hash_index(new, list->index->hash) != LIST_SUCCESS) {
+    list_destroy(new);
+    return 0;
+  }
+
+  // an iterator on the start edge splits before the first node.
+  Node* from = (iterator->node == list->head && iterator->start_edge) ? list->head->next : iterator->node;
+  size_t count;
+  __count_range(list, from, list->head, &count);
+  if (count != 0) {
+    Node* moved = __move_range(new, new->head, list, from, list->head, count);
+    if (moved == 0) {
+      list_destroy(new);
+      return 0;
+    }
+    iterator->list = new;
+    iterator->node = moved;
+    iterator->start_edge = iterator->end_edge = false;
+  }
+
+  return new;
+}
+
+ListStatus list_merge(List dst, List src) {
+  if (dst == 0 || src == 0 || dst == src || !__can_move(dst, src)) {
+    return LIST_EINVAL;
+  }
+
+  size_t count = dst->size;
+  if (src->size == 0) {
+    return LIST_SUCCESS;
+  }
+
+  ListStatus status = __writable(dst, 0, 0);
+  if (status != LIST_SUCCESS) {
+    return status;
+  }
+  status = __writable(src, 0, 0);
+  if (status != LIST_SUCCESS) {
+    return status;
+  }
+  Node* second = __move_range(dst, dst->head, src, src->head->next, src->head, src->size);
+  if (second == 0) {
+    return LIST_NO_MEM;
+  }
+  if (count == 0) {
+    return LIST_SUCCESS;
+  }
+
+  // the two sorted runs are merged by relinking, as list_sort does. ties go
+  // to the first run, so the merge is stable.
+  Node* first = __detach_chain(dst);
+  second->prev->next = 0;
+  __attach_chain(dst, __merge(first, second, dst->data_compare));
+
+  return LIST_SUCCESS;
+}
+
+// finds the node after which data goes in a sorted list, after its equals,
+// walking from a given node in the direction of the position.
+static Node* __sorted_position(const List list, Node* node, const ListData* data) {
+  if (node != list->head && list->data_compare(node->data, data) > 0) {
+    do {
+      node = node->prev;
+    } while (node != list->head && list->data_compare(node->data, data) > 0);
+  } else {
+    while (node->next != list->head && list->data_compare(node->next->data, data) <= 0) {
+      node = node->next;
+    }
+  }
+
+  return node;
+}
+
+ListStatus list_insert_sorted(List list, const ListData* data, ListIterator hint) {
+  if (list == 0 || data == 0 || (hint != 0 && hint->list != list)) {
+    return LIST_EINVAL;
+  }
+
+  ListStatus status = __writable(list, &hint, 1);
+  if (status != LIST_SUCCESS) {
+    return status;
+  }
+
+  // the new node is read while the list is locked, since other writers may
+  // link or remove nodes after it once it is unlocked.
+  __lock_all(list);
+  Node* after = __sorted_position(list, (hint != 0) ? hint->node : list->head, data);
+  status = __list_insert(list, after->next, data);
+  if (status == LIST_SUCCESS && hint != 0) {
+    hint->node = after->next;
+    hint->start_edge = hint->end_edge = false;
+  }
+  __unlock_all(list);
+
+  return status;
+}
+
+size_t list_get_size(const List list) {
+  return __atomic_load_n(&list->size, __ATOMIC_RELAXED);
+}
+
+bool list_empty(const List list) {
+  return list_get_size(list) == 0;
+}
+
+
+
+/******************************************************************************
+*               Functions that works on iterator                              *
+******************************************************************************/
+
+static void __iterator_init(ListIterator iterator, const List list) {
+  iterator->list = list;
+  iterator->node = __next_of(list, list->head, 0);
+  iterator->end_edge = false;
+  iterator->start_edge = (iterator->node == list->head) ? true : false;
+  iterator->heap = false;
+}
+
+ListIterator list_iterator_init(ListIteratorStorage * storage, const List list) {
+  if (storage == 0 || list == 0) {
+    return 0;
+  }
+
+  ListIterator iterator = (ListIterator)storage;
+  __iterator_init(iterator, list);
+
+  return iterator;
+}
+
+ListIterator list_iterator_create(const List list) {
+  if (list == 0) {
+    return 0;
+  }
+
+  ListIterator iterator = malloc(sizeof(*iterator));
+  if (iterator == 0) {
+    return 0;
+  }
+
+  __iterator_init(iterator, list);
+  iterator->heap = true;
+
+  return iterator;
+}
+
+ListIterator list_iterator_init_copy(ListIteratorStorage * storage, const ListIterator iterator) {
+  if (storage == 0 || iterator == 0) {
+    return 0;
+  }
+
+  ListIterator new = (ListIterator)storage;
+  *new = *iterator;
+  new->heap = false;
+
+  return new;
+}
+
+ListIterator list_iterator_copy(const ListIterator iterator) {
+  if (iterator == 0) {
+    return 0;
+  }
+
+  ListIterator new = malloc(sizeof(*new));
+  if (new == 0) {
+    return 0;
+  }
+
+  *new = *iterator;
+  new->heap = true;
+
+  return new;
+}
+
+ListIteratorStatus list_iterator_first(ListIterator iterator) {
+  if (iterator == 0) {
+    return LIST_ITERATOR_EINVAL;
+  }
+
+  iterator->node = __next_of(iterator->list, iterator->list->head, 0);
+  if (iterator->node == iterator->list->head) {
+    iterator->start_edge = true;
+    iterator->end_edge = false;
+    return LIST_ITERATOR_END;
+  }
+  iterator->start_edge = false;
+  iterator->end_edge = false;
+
+  return LIST_ITERATOR_SUCCESS;
+}
+
+ListIteratorStatus list_iterator_last(ListIterator iterator) {
+  if (iterator == 0) {
+    return LIST_ITERATOR_EINVAL;
+  }
+
+  iterator->node = __prev_of(iterator->list, iterator->list->head, 0);
+  if (iterator->node == iterator->list->head) {
+    iterator->start_edge = false;
+    iterator->end_edge = true;
+    return LIST_ITERATOR_END;
+  }
+  iterator->start_edge = false;
+  iterator->end_edge = false;
+
+  return LIST_ITERATOR_SUCCESS;
+}
+
+// heads hold no element, so an iterator stops on the edges of the list its
+// node is in, even after the node moved to another list.
+ListIteratorStatus list_iterator_next(ListIterator iterator) {
+  if (iterator == 0 || iterator->end_edge) {
+    return LIST_ITERATOR_EINVAL;
+  }
+
+  iterator->start_edge = false;
+  iterator->node = __next_of(iterator->list, iterator->node, 0);
+  if (iterator->node->data == 0) {
+    iterator->end_edge = true;
+    return LIST_ITERATOR_END;
+  }
+
+  return LIST_ITERATOR_SUCCESS;
+}
+
+ListIteratorStatus list_iterator_prev(ListIterator iterator) {
+  if (iterator == 0 || iterator->start_edge) {
+    return LIST_ITERATOR_EINVAL;
+  }
+
+  iterator->end_edge = false;
+  iterator->node = __prev_of(iterator->list, iterator->node, 0);
+  if (iterator->node->data == 0) {
+    iterator->start_edge = true;
+    return LIST_ITERATOR_END;
+  }
+
+  return LIST_ITERATOR_SUCCESS;
+}
+
+ListIteratorStatus list_iterator_start(ListIterator iterator) {
+  if (iterator == 0) {
+    return LIST_ITERATOR_EINVAL;
+  }
+
+  iterator->node = iterator->list->head;
+  iterator->start_edge = true;
+  iterator->end_edge = false;
+
+  return LIST_ITERATOR_SUCCESS;
+}
+
+ListIteratorStatus list_iterator_end(ListIterator iterator) {
+  if (iterator == 0) {
+    return LIST_ITERATOR_EINVAL;
+  }
+
+  iterator->node = iterator->list->head;
+  iterator->start_edge = false;
+  iterator->end_edge = true;
+
+  return LIST_ITERATOR_SUCCESS;
+}
+
+ListData * list_iterator_get(ListIterator iterator) {
+  if (iterator == 0) {
+    return 0;
+  }
+
+  return iterator->node->data;
+}
+
+// readers of RCU lists may be reading the old element, so the node is
+// replaced by a new one, and the old one is freed after a grace period.
+static ListIteratorStatus __rcu_replace(ListIterator iterator, ListData * data) {
+  List list = iterator->list;
+  Node* new = node_create(list);
+  if (new == 0) {
+    return LIST_ITERATOR_NO_MEM;
+  }
+  new->data = data;
+
+  Node* old = iterator->node;
+  pthread_mutex_lock(&list->rcu->writer);
+  __link_before(list, old->next, new);
+  __unlink(list, old);
+  __rcu_defer(list, old);
+  pthread_mutex_unlock(&list->rcu->writer);
+  iterator->node = new;
+
+  return LIST_ITERATOR_SUCCESS;
+}
+
+ListIteratorStatus list_iterator_set(ListIterator iterator, const ListData * val) {
+  if (iterator == 0 || val == 0 || iterator->node == 0 || iterator->node == iterator->list->head) {
+    return LIST_ITERATOR_EINVAL;
+  }
+
+  ListStatus writable = __writable(iterator->list, &iterator, 1);
+  if (writable != LIST_SUCCESS) {
+    return (writable == LIST_EINVAL) ? LIST_ITERATOR_EINVAL : LIST_ITERATOR_NO_MEM;
+  }
+
+  // other threads may be comparing or handing out the element meanwhile.
+  if (iterator->list->elem_size != 0) {
+    __lock_all(iterator->list);
+    __node_replace(iterator->list, iterator->node, val);
+    __unlock_all(iterator->list);
+    return LIST_ITERATOR_SUCCESS;
+  }
+
+  ListData * new_data = iterator->list->data_copy(val);
+  if (new_data == 0) {
+    return LIST_ITERATOR_NO_MEM;
+  }
+
+  if (iterator->list->rcu != 0) {
+    ListIteratorStatus status = __rcu_replace(iterator, new_data);
+    if (status != LIST_ITERATOR_SUCCESS) {
+      iterator->list->data_free(new_data);
+    }
+    return status;
+  }
+
+  __lock_all(iterator->list);
+  __node_replace(iterator->list, iterator->node, new_data);
+  __unlock_all(iterator->list);
+
+  return LIST_ITERATOR_SUCCESS;
+}
+
+ListIteratorStatus list_iterator_set_take(ListIterator iterator, ListData * val) {
+  if (iterator == 0 || val == 0 || iterator->node == iterator->list->head) {
+    return LIST_ITERATOR_EINVAL;
   }
 
-  if (list->iterator == iterator) {
-    list->iterator = list->iterator->next;
+  ListStatus writable = __writable(iterator->list, &iterator, 1);
+  if (writable != LIST_SUCCESS) {
+    return (writable == LIST_EINVAL) ? LIST_ITERATOR_EINVAL : LIST_ITERATOR_NO_MEM;
   }
 
-  Node* next = iterator->next;
-  Node* prev = iterator->prev;
-  prev->next = next;
-  next->prev = prev;
+  if (iterator->list->rcu != 0) {
+    return __rcu_replace(iterator, val);
+  }
 
-  node_destroy(iterator, list->data_free);
-  --list->size;
+  __lock_all(iterator->list);
+  __node_replace(iterator->list, iterator->node, val);
+  __unlock_all(iterator->list);
+  if (iterator->list->elem_size != 0) {
+    iterator->list->data_free(val);
+  }
 
-  return LIST_SUCCESS;
+  return LIST_ITERATOR_SUCCESS;
 }
 
-ListData * list_pop_front(List list) {
-  if (list == 0 || list->size == 0) {
-    return 0;
+void list_iterator_destroy(ListIterator iterator) {
+  if (iterator != 0 && iterator->heap) {
+    free(iterator);
   }
+}
 
-  Node * first_node = __list_get_first(list);
-  list->head->next = first_node->next;
-  first_node->next->prev = list->head;
-  ListData * data = first_node->data;
-  free(first_node);
-  --list->size;
+bool list_iterator_equal(const ListIterator first, const ListIterator second) {
+  if (first->node == second->node) {
+    return (first->start_edge == second->start_edge && first->end_edge == second->end_edge);
+  }
 
-  return data;
+  return false;
 }
 
-ListData * list_pop_back(List list) {
-  if (list == 0 || list->size == 0) {
+
+
+/******************************************************************************
+*                    Functions that works on RCU readers                      *
+******************************************************************************/
+
+ListReader list_rcu_register(const List list) {
+  if (list == 0 || list->rcu == 0) {
     return 0;
   }
 
-  Node * last_node = __list_get_last(list);
-  list->head->prev = last_node->prev;
-  last_node->prev->next = list->head;
-  ListData * data = last_node->data;
-  free(last_node);
-  --list->size;
+  ListReader reader = malloc(sizeof(*reader));
+  if (reader == 0) {
+    return 0;
+  }
+  reader->list = list;
+  reader->period = 0;
+  reader->nesting = 0;
 
-  return data;
+  pthread_mutex_lock(&list->rcu->readers_lock);
+  reader->next = list->rcu->readers;
+  list->rcu->readers = reader;
+  pthread_mutex_unlock(&list->rcu->readers_lock);
+
+  return reader;
 }
 
-ListStatus list_remove_at(List list, size_t n) {
-  if (list == 0 || n >= list->size) {
-    return LIST_EINVAL;
+void list_rcu_unregister(ListReader reader) {
+  if (reader == 0) {
+    return;
   }
 
-  Node * iterator;
-  list_foreach(iterator, list) {
-    if (n-- == 0) {
-      break;
-    }
+  RcuState* rcu = reader->list->rcu;
+  pthread_mutex_lock(&rcu->readers_lock);
+  ListReader* link = &rcu->readers;
+  while (*link != reader) {
+    link = &(*link)->next;
   }
+  *link = reader->next;
+  pthread_mutex_unlock(&rcu->readers_lock);
+  free(reader);
+}
 
-  // fix the iterator if it points to the removed element
-  if (list->iterator == iterator) {
-    list->iterator = list->iterator->next;
+void list_rcu_read_lock(ListReader reader) {
+  if (reader->nesting++ != 0) {
+    return;
   }
 
-  iterator->prev->next = iterator->next;
-  iterator->next->prev = iterator->prev;
-  node_destroy(iterator, list->data_free);
-  --list->size;
+  // a writer which bumped the period after this store either waits for the
+  // reader, or unlinked its nodes before the reader could see them.
+  uint64_t period = __atomic_load_n(&reader->list->rcu->period, __ATOMIC_ACQUIRE);
+  __atomic_store_n(&reader->period, period, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
 
-  return LIST_SUCCESS;
+void list_rcu_read_unlock(ListReader reader) {
+  if (--reader->nesting == 0) {
+    __atomic_store_n(&reader->period, 0, __ATOMIC_RELEASE);
+  }
 }
 
-ListStatus list_remove_iterator(List list, ListIterator iterator) {
-  if (list == 0 || iterator == 0 || list != iterator->list) {
+ListStatus list_rcu_synchronize(List list) {
+  if (list == 0 || list->rcu == 0) {
     return LIST_EINVAL;
   }
 
-  Node * prev = iterator->node->prev;
-  Node * next = iterator->node->next;
-  prev->next = next;
-  next->prev = prev;
-  node_destroy(iterator->node, list->data_free);
-  --list->size;
-
-  // fix the iterator to point to next element
-  iterator->node = next;
-  if (iterator->node == list->head) {
-    iterator->end_edge = true;
-  }
+  pthread_mutex_lock(&list->rcu->writer);
+  __rcu_flush(list);
+  pthread_mutex_unlock(&list->rcu->writer);
 
   return LIST_SUCCESS;
 }
 
-void list_clear(List list) {
-  if (list != 0) {
-    Node *to_delete;
-    list->iterator = list->head->next;
-    while (list->iterator != list->head) {
-      to_delete = list->iterator;
-      list->iterator = list->iterator->next;
-      node_destroy(to_delete, list->data_free);
+
+
+/******************************************************************************
+*                       Functions that works on a queue                       *
+******************************************************************************/
+
+static HazardRecord* __claim_record(ListQueue queue) {
+  HazardRecord* record = __atomic_load_n(&queue->records, __ATOMIC_ACQUIRE);
+  for (; record != 0; record = record->next) {
+    bool expected = false;
+    if (!__atomic_load_n(&record->active, __ATOMIC_RELAXED) &&
+        __atomic_compare_exchange_n(&record->active, &expected, true, false,
+                                    __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+      return record;
     }
+  }
 
-    // finished freeing. now fix the list to empty.
-    list->head->next = list->head->prev = list->head;
-    list->size = 0;
-    list->iterator = list->head;
+  // all the records are in use, so another one is added. records are only
+  // freed with the queue.
+  record = calloc(1, sizeof(*record));
+  if (record == 0) {
+    return 0;
   }
+  record->active = true;
+  __atomic_fetch_add(&queue->record_count, 1, __ATOMIC_RELAXED);
+
+  HazardRecord* first = __atomic_load_n(&queue->records, __ATOMIC_RELAXED);
+  do {
+    record->next = first;
+  } while (!__atomic_compare_exchange_n(&queue->records, &first, record, true,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+  return record;
 }
 
-void list_destroy(List list) {
-  if (list != 0) {
-    list_clear(list);
-    node_destroy(list->head, list->data_free);
-    free(list);
+static void __release_record(HazardRecord* record) {
+  for (size_t i = 0; i < QUEUE_HAZARDS; ++i) {
+    __atomic_store_n(&record->hazards[i], 0, __ATOMIC_RELEASE);
   }
+  __atomic_store_n(&record->active, false, __ATOMIC_RELEASE);
 }
 
-List list_copy(const List list) {
-  if (list == 0) {
-    return 0;
+// loads the node at *source and sets a hazard pointer to it, which keeps it
+// from being freed as long as it was still at *source once the hazard pointer
+// was visible.
+static QueueNode* __protect(HazardRecord* record, size_t hazard, QueueNode** source) {
+  QueueNode* node = __atomic_load_n(source, __ATOMIC_ACQUIRE);
+  for (;;) {
+    __atomic_store_n(&record->hazards[hazard], node, __ATOMIC_SEQ_CST);
+    QueueNode* again = __atomic_load_n(source, __ATOMIC_SEQ_CST);
+    if (again == node) {
+      return node;
+    }
+    node = again;
   }
+}
 
-  List new = list_create(list->data_copy, list->data_free, list->data_compare);
-  if (new == 0) {
-    return 0;
-  }
+static int __compare_nodes(const void* a, const void* b) {
+  uintptr_t x = (uintptr_t)*(QueueNode* const*)a;
+  uintptr_t y = (uintptr_t)*(QueueNode* const*)b;
 
-  Node* iterator;
-  list_foreach(iterator, list) {
-    if (list_push_back(new, iterator->data) != LIST_SUCCESS) {
-      list_destroy(new);
-      return 0;
+  return (x > y) - (x < y);
+}
+
+// frees the retired nodes of a record which no record has a hazard pointer
+// to. records are only ever pushed at the front of the list, so the records
+// seen from one load of its front are a fixed set, which is counted first and
+// then walked whole. records added after that load belong to operations which
+// started after the nodes were removed, and cannot reach them.
+static void __scan(ListQueue queue, HazardRecord* record) {
+  HazardRecord* first = __atomic_load_n(&queue->records, __ATOMIC_SEQ_CST);
+  size_t count = 0;
+  for (HazardRecord* other = first; other != 0; other = other->next) {
+    count += QUEUE_HAZARDS;
+  }
+  QueueNode** hazards = malloc(sizeof(*hazards) * count);
+  if (hazards == 0) {
+    return;
+  }
+
+  size_t n = 0;
+  for (HazardRecord* other = first; other != 0; other = other->next) {
+    for (size_t i = 0; i < QUEUE_HAZARDS; ++i) {
+      QueueNode* hazard = __atomic_load_n(&other->hazards[i], __ATOMIC_SEQ_CST);
+      if (hazard != 0) {
+        hazards[n++] = hazard;
+      }
     }
   }
+  qsort(hazards, n, sizeof(*hazards), __compare_nodes);
 
-  return new;
+  size_t kept = 0;
+  for (size_t i = 0; i < record->retired_count; ++i) {
+    QueueNode* node = record->retired[i];
+    if (bsearch(&node, hazards, n, sizeof(*hazards), __compare_nodes) != 0) {
+      record->retired[kept++] = node;
+    } else {
+      free(node);
+    }
+  }
+  record->retired_count = kept;
+  free(hazards);
 }
 
-ListData const * list_find(const List list, const ListData * data) {
-  if (list == 0 || data == 0) {
-    return 0;
+// the threshold keeps the number of nodes waiting to be freed proportional to
+// the number of hazard pointers, while scanning rarely enough to be cheap.
+#define RETIRE_THRESHOLD 64
+
+static void __retire(ListQueue queue, HazardRecord* record, QueueNode* node) {
+  if (record->retired_count == record->retired_capacity) {
+    size_t capacity = (record->retired_capacity == 0) ? RETIRE_THRESHOLD : record->retired_capacity * 2;
+    QueueNode** retired = realloc(record->retired, sizeof(*retired) * capacity);
+    if (retired == 0) {
+      // another thread may still read the node, so it is leaked rather than
+      // freed.
+      return;
+    }
+    record->retired = retired;
+    record->retired_capacity = capacity;
   }
+  record->retired[record->retired_count++] = node;
 
-  return __find_node(list, data)->data;
+  size_t threshold = 2 * QUEUE_HAZARDS * __atomic_load_n(&queue->record_count, __ATOMIC_RELAXED);
+  if (threshold < RETIRE_THRESHOLD) {
+    threshold = RETIRE_THRESHOLD;
+  }
+  if (record->retired_count >= threshold) {
+    __scan(queue, record);
+  }
 }
 
+ListQueue list_queue_create(ListCopyFunction data_copy, ListFreeFunction data_free) {
+  if (data_copy == 0 || data_free == 0) {
+    return 0;
+  }
 
-static ListData ** __merge(ListData ** a, size_t size_a, ListData ** b, size_t size_b, ListCompareFunction data_compare) {
-  size_t a_idx = 0, b_idx = 0, merged_idx = 0;
-  ListData ** merged = malloc(sizeof(*merged) * (size_a + size_b));
-  if (merged == 0) {
+  ListQueue queue = malloc(sizeof(*queue));
+  if (queue == 0) {
     return 0;
   }
 
-  while (a_idx < size_a && b_idx < size_b) {
-    if (data_compare(a[a_idx], b[b_idx]) <= 0) {
-      merged[merged_idx++] = a[a_idx++];
-    } else {
-      merged[merged_idx++] = b[b_idx++];
-    }
+  QueueNode* dummy = malloc(sizeof(*dummy));
+  if (dummy == 0) {
+    free(queue);
+    return 0;
   }
+  dummy->data = 0;
+  dummy->next = 0;
 
-  while (a_idx < size_a) merged[merged_idx++] = a[a_idx++];
-  while (b_idx < size_b) merged[merged_idx++] = b[b_idx++];
+  queue->head = queue->tail = dummy;
+  queue->records = 0;
+  queue->record_count = 0;
+  queue->data_copy = data_copy;
+  queue->data_free = data_free;
 
-  return merged;
+  return queue;
 }
 
-// return 0 in case of success and 1 in case of failure (bad allocation).
-static int __merge_sort(ListData ** a, size_t size, ListCompareFunction data_compare) {
-  if (size <= 1) return 0;
+void list_queue_destroy(ListQueue queue) {
+  if (queue == 0) {
+    return;
+  }
 
-  int res = 0;
-  res += __merge_sort(a, size / 2, data_compare);
-  res += __merge_sort(a + size / 2, size - size / 2, data_compare);
-  ListData ** sorted = __merge(a, size / 2, a + size / 2, size - size / 2, data_compare);
-  if (sorted == 0) {
-    return 1;
+  QueueNode* node = queue->head->next;
+  free(queue->head);
+  while (node != 0) {
+    QueueNode* next = node->next;
+    queue->data_free(node->data);
+    free(node);
+    node = next;
   }
-  for (size_t i = 0; i < size; ++i) {
-    a[i] = sorted[i];
+
+  HazardRecord* record = queue->records;
+  while (record != 0) {
+    HazardRecord* next = record->next;
+    for (size_t i = 0; i < record->retired_count; ++i) {
+      free(record->retired[i]);
+    }
+    free(record->retired);
+    free(record);
+    record = next;
   }
 
-  free(sorted);
-  return (res == 0 ? 0 : 1); // 0 for success, 1 for failure
+  free(queue);
 }
 
-// the idea is to transfer the list elements to an array, sort the array using
-// merge-sort, and then update the list nodes using the sorted array.
-// this gives an O(n*log(n)) worst case sorting to the list.
-// the additional mess is due to memory managment, and asserting that in case
-// of an error, the list stays intact.
-ListStatus list_sort(List list) {
-  if (list == 0) {
-    return LIST_EINVAL;
+static ListStatus __queue_push(ListQueue queue, ListData* data) {
+  QueueNode* node = malloc(sizeof(*node));
+  if (node == 0) {
+    return LIST_NO_MEM;
   }
+  node->data = data;
+  node->next = 0;
 
-  List sorted_list = list_copy(list);
-  if (sorted_list == 0) {
-    return LIST_FAIL;
+  HazardRecord* record = __claim_record(queue);
+  if (record == 0) {
+    free(node);
+    return LIST_NO_MEM;
   }
 
-  // from this point onward, we only use sorted_list.
-  // this is done to ensure that if some error should occur,
-  // the original list will stay intact.
-  ListData ** listArray = malloc(sizeof(*listArray) * sorted_list->size);
-  if (listArray == 0) {
-    list_destroy(sorted_list);
-    return LIST_FAIL;
-  }
+  for (;;) {
+    QueueNode* tail = __protect(record, 0, &queue->tail);
+    QueueNode* next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    if (next != 0) {
+      // the tail lags behind another push, which is helped along.
+      __atomic_compare_exchange_n(&queue->tail, &tail, next, false,
+                                  __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+      continue;
+    }
 
-  Node* iterator;
-  size_t i = 0;
-  list_foreach(iterator, sorted_list) {
-    listArray[i++] = sorted_list->data_copy(iterator->data);
-    if (listArray[i - 1] == 0) {
-      for (size_t j = 0; j < i - 1; ++j) {
-        sorted_list->data_free(listArray[j]);
-      }
-      free(listArray);
-      list_destroy(sorted_list);
-      return LIST_FAIL;
+    if (__atomic_compare_exchange_n(&tail->next, &next, node, false,
+                                    __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+      // fails only if another operation moved the tail forward already.
+      __atomic_compare_exchange_n(&queue->tail, &tail, node, false,
+                                  __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+      break;
     }
   }
+  __release_record(record);
 
-  int res = __merge_sort(listArray, sorted_list->size, sorted_list->data_compare);
+  return LIST_SUCCESS;
+}
 
-  // if res == 1, some error occurred during __merge_sort
-  if (res) {
-    free(listArray);
-    list_destroy(sorted_list);
-    return LIST_FAIL;
+ListStatus list_queue_push(ListQueue queue, const ListData * data) {
+  if (queue == 0 || data == 0) {
+    return LIST_EINVAL;
   }
 
-  // update sorted_list (to be sorted)
-  i = 0;
-  list_foreach(iterator, sorted_list) {
-    sorted_list->data_free(iterator->data);
-    iterator->data = listArray[i++];
+  ListData* copy = queue->data_copy(data);
+  if (copy == 0) {
+    return LIST_NO_MEM;
   }
-  free(listArray);
 
-  // sorting went fine. it is safe to swap the lists.
-  Node * tmp_head = list->head;
-  list->head = sorted_list->head;
-  list->iterator = list->head;
-  sorted_list->head = tmp_head;
-  list_destroy(sorted_list);
+  ListStatus status = __queue_push(queue, copy);
+  if (status != LIST_SUCCESS) {
+    queue->data_free(copy);
+  }
 
-  return LIST_SUCCESS;
+  return status;
 }
 
-size_t list_get_size(const List list) {
-  return list->size;
-}
+ListStatus list_queue_push_take(ListQueue queue, ListData * data) {
+  if (queue == 0 || data == 0) {
+    return LIST_EINVAL;
+  }
 
-bool list_empty(const List list) {
-  return list_get_size(list) == 0;
+  return __queue_push(queue, data);
 }
 
-
-
-/******************************************************************************
-*               Functions that works on iterator                              *
-******************************************************************************/
-
-ListIterator list_iterator_create(const List list) {
-  if (list == 0) {
+ListData * list_queue_pop(ListQueue queue) {
+  if (queue == 0) {
     return 0;
   }
 
-  ListIterator iterator = malloc(sizeof(*iterator));
-  if (iterator == 0) {
+  HazardRecord* record = __claim_record(queue);
+  if (record == 0) {
     return 0;
   }
 
-  iterator->list = list;
-  iterator->node = __list_get_first(list);
-  iterator->end_edge = false;
-  iterator->start_edge = (list->size == 0) ? true : false;
+  ListData* data;
+  for (;;) {
+    QueueNode* head = __protect(record, 0, &queue->head);
+    // the next node is only retired after the head is, so if the head is
+    // still in place, the hazard pointer to the next node holds.
+    QueueNode* next = __protect(record, 1, &head->next);
+    if (__atomic_load_n(&queue->head, __ATOMIC_SEQ_CST) != head) {
+      continue;
+    }
+    if (next == 0) {
+      data = 0;
+      break;
+    }
 
-  return iterator;
-}
+    QueueNode* tail = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+    if (head == tail) {
+      // the head never passes the tail, so a lagging tail is helped along.
+      __atomic_compare_exchange_n(&queue->tail, &tail, next, false,
+                                  __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+      continue;
+    }
 
-ListIterator list_iterator_copy(const ListIterator iterator) {
-  if (iterator == 0) {
-    return 0;
+    // the next node becomes the dummy, and its element goes to the caller.
+    data = next->data;
+    if (__atomic_compare_exchange_n(&queue->head, &head, next, false,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+      __retire(queue, record, head);
+      break;
+    }
   }
+  __release_record(record);
 
-  ListIterator new = malloc(sizeof(*new));
-  if (new == 0) {
+  return data;
+}
+
+/******************************************************************************
+*                    Functions that works on a reclaimer                      *
+******************************************************************************/
+
+// nodes a reclaimer thread frees between looks at its garbage and at stop.
+#define RECLAIM_BATCH 4096
+
+static Garbage* __garbage_create(const List list) {
+  Garbage* garbage = malloc(sizeof(*garbage));
+  if (garbage == 0) {
     return 0;
   }
 
-  new->list = iterator->list;
-  new->node = iterator->node;
-  new->start_edge = iterator->start_edge;
-  new->end_edge = iterator->end_edge;
+  garbage->chain = 0;
+  garbage->count = 0;
+  // inline elements are freed along with their node.
+  garbage->data_free = (list->elem_size == 0) ? list->data_free : 0;
+  garbage->allocator = list->allocator;
+  garbage->allocator_state = 0;
+  garbage->own_state = false;
+  garbage->index = 0;
+  garbage->next = 0;
 
-  return new;
+  return garbage;
 }
 
-ListIteratorStatus list_iterator_first(ListIterator iterator) {
-  if (iterator == 0) {
-    return LIST_ITERATOR_EINVAL;
+// drops a reference to nodes shared with copy-on-write copies, as
+// __drop_shares does, but the last one hands the nodes to garbage instead of
+// freeing them.
+static void __drop_shares_async(Node* head, size_t* shares, size_t size, Garbage* garbage) {
+  if (__atomic_sub_fetch(shares, 1, __ATOMIC_ACQ_REL) != 0) {
+    return;
   }
 
-  iterator->node = __list_get_first(iterator->list);
-  if (iterator->node == iterator->list->head) {
-    iterator->start_edge = true;
-    iterator->end_edge = false;
-    return LIST_ITERATOR_END;
+  free(shares);
+  if (head->next != head) {
+    head->prev->next = 0;
+    garbage->chain = head->next;
+    garbage->count = size;
   }
-  iterator->start_edge = false;
-  iterator->end_edge = false;
-
-  return LIST_ITERATOR_SUCCESS;
+  free(head);
 }
 
-ListIteratorStatus list_iterator_last(ListIterator iterator) {
-  if (iterator == 0) {
-    return LIST_ITERATOR_EINVAL;
+// frees up to @budget nodes of garbage, adding their number to @reclaimed,
+// and after the last one the garbage itself along with its allocator state
+// and index. nodes whose allocator state is released at once are walked only
+// to free their data. returns true once the garbage is freed.
+static bool __reclaim(Garbage* garbage, size_t budget, size_t* reclaimed) {
+  bool release = garbage->own_state && garbage->allocator.create != 0 &&
+                 garbage->allocator.release != 0;
+  size_t freed = 0;
+  if (release && garbage->data_free == 0) {
+    freed = garbage->count;
+    garbage->chain = 0;
+  }
+  for (; garbage->chain != 0 && freed < budget; ++freed) {
+    Node* node = garbage->chain;
+    garbage->chain = node->next;
+    if (garbage->data_free != 0 && node->data != 0) {
+      garbage->data_free(node->data);
+    }
+    if (!release) {
+      garbage->allocator.free(garbage->allocator_state, node);
+    }
+  }
+  garbage->count -= freed;
+  *reclaimed += freed;
+  if (garbage->chain != 0) {
+    return false;
   }
 
-  iterator->node = __list_get_last(iterator->list);
-  if (iterator->node == iterator->list->head) {
-    iterator->start_edge = false;
-    iterator->end_edge = true;
-    return LIST_ITERATOR_END;
+  if (garbage->own_state) {
+    if (release) {
+      garbage->allocator.release(garbage->allocator_state);
+    }
+    if (garbage->allocator.destroy != 0) {
+      garbage->allocator.destroy(garbage->allocator_state);
+    }
   }
-  iterator->start_edge = false;
-  iterator->end_edge = false;
+  index_destroy(garbage->index);
+  free(garbage);
 
-  return LIST_ITERATOR_SUCCESS;
+  return true;
 }
 
-ListIteratorStatus list_iterator_next(ListIterator iterator) {
-  if (iterator == 0 || iterator->end_edge) {
-    return LIST_ITERATOR_EINVAL;
-  }
+static void __reclaimer_push(ListReclaimer reclaimer, Garbage* garbage) {
+  garbage->next = 0;
+  pthread_mutex_lock(&reclaimer->lock);
+  if (reclaimer->last == 0) {
+    reclaimer->first = garbage;
+  } else {
+    reclaimer->last->next = garbage;
+  }
+  reclaimer->last = garbage;
+  pthread_cond_signal(&reclaimer->pending);
+  pthread_mutex_unlock(&reclaimer->lock);
+}
 
-  iterator->start_edge = false;
-  iterator->node = iterator->node->next;
-  if (iterator->node == iterator->list->head) {
-    iterator->end_edge = true;
-    return LIST_ITERATOR_END;
+static void* __reclaim_thread(void* arg) {
+  ListReclaimer reclaimer = arg;
+  pthread_mutex_lock(&reclaimer->lock);
+  while (!reclaimer->stop) {
+    if (reclaimer->first == 0) {
+      pthread_cond_wait(&reclaimer->pending, &reclaimer->lock);
+      continue;
+    }
+
+    pthread_mutex_unlock(&reclaimer->lock);
+    list_reclaim_step(reclaimer, RECLAIM_BATCH);
+    pthread_mutex_lock(&reclaimer->lock);
   }
+  pthread_mutex_unlock(&reclaimer->lock);
 
-  return LIST_ITERATOR_SUCCESS;
+  return 0;
 }
 
-ListIteratorStatus list_iterator_prev(ListIterator iterator) {
-  if (iterator == 0 || iterator->start_edge) {
-    return LIST_ITERATOR_EINVAL;
+ListReclaimer list_reclaimer_create(bool background) {
+  ListReclaimer reclaimer = malloc(sizeof(*reclaimer));
+  if (reclaimer == 0) {
+    return 0;
   }
 
-  iterator->end_edge = false;
-  iterator->node = iterator->node->prev;
-  if (iterator->node == iterator->list->head) {
-    iterator->start_edge = true;
-    return LIST_ITERATOR_END;
+  pthread_mutex_init(&reclaimer->lock, 0);
+  pthread_cond_init(&reclaimer->pending, 0);
+  reclaimer->first = reclaimer->last = 0;
+  reclaimer->stop = false;
+  reclaimer->background = false;
+  if (background) {
+    if (pthread_create(&reclaimer->thread, 0, __reclaim_thread, reclaimer) != 0) {
+      pthread_cond_destroy(&reclaimer->pending);
+      pthread_mutex_destroy(&reclaimer->lock);
+      free(reclaimer);
+      return 0;
+    }
+    reclaimer->background = true;
   }
 
-  return LIST_ITERATOR_SUCCESS;
+  return reclaimer;
 }
 
-ListIteratorStatus list_iterator_start(ListIterator iterator) {
-  if (iterator == 0) {
-    return LIST_ITERATOR_EINVAL;
+void list_reclaimer_destroy(ListReclaimer reclaimer) {
+  if (reclaimer == 0) {
+    return;
   }
 
-  iterator->node = iterator->list->head;
-  iterator->start_edge = true;
-  iterator->end_edge = false;
+  if (reclaimer->background) {
+    pthread_mutex_lock(&reclaimer->lock);
+    reclaimer->stop = true;
+    pthread_cond_signal(&reclaimer->pending);
+    pthread_mutex_unlock(&reclaimer->lock);
+    pthread_join(reclaimer->thread, 0);
+  }
 
-  return LIST_ITERATOR_SUCCESS;
+  // whatever the thread did not get to is freed here.
+  list_reclaim_step(reclaimer, SIZE_MAX);
+  pthread_cond_destroy(&reclaimer->pending);
+  pthread_mutex_destroy(&reclaimer->lock);
+  free(reclaimer);
 }
 
-ListIteratorStatus list_iterator_end(ListIterator iterator) {
-  if (iterator == 0) {
-    return LIST_ITERATOR_EINVAL;
+size_t list_reclaim_step(ListReclaimer reclaimer, size_t budget) {
+  if (reclaimer == 0) {
+    return 0;
   }
 
-  iterator->node = iterator->list->head;
-  iterator->start_edge = false;
-  iterator->end_edge = true;
-
-  return LIST_ITERATOR_SUCCESS;
-}
+  size_t reclaimed = 0;
+  while (reclaimed < budget) {
+    pthread_mutex_lock(&reclaimer->lock);
+    Garbage* garbage = reclaimer->first;
+    if (garbage != 0) {
+      reclaimer->first = garbage->next;
+      if (reclaimer->first == 0) {
+        reclaimer->last = 0;
+      }
+    }
+    pthread_mutex_unlock(&reclaimer->lock);
+    if (garbage == 0) {
+      break;
+    }
 
-ListData * list_iterator_get(ListIterator iterator) {
-  if (iterator == 0) {
-    return 0;
+    // out of budget, the rest of the garbage goes first next time.
+    if (!__reclaim(garbage, budget - reclaimed, &reclaimed)) {
+      pthread_mutex_lock(&reclaimer->lock);
+      garbage->next = reclaimer->first;
+      reclaimer->first = garbage;
+      if (reclaimer->last == 0) {
+        reclaimer->last = garbage;
+      }
+      pthread_mutex_unlock(&reclaimer->lock);
+    }
   }
 
-  return iterator->node->data;
+  return reclaimed;
 }
 
-ListIteratorStatus list_iterator_set(ListIterator iterator, const ListData * val) {
-  if (iterator == 0 || iterator->node == 0) {
-    return LIST_ITERATOR_EINVAL;
+void list_clear_async(List list, ListReclaimer reclaimer) {
+  if (list == 0 || list->read_only) {
+    return;
+  }
+
+  // the list goes on with a new head, allocator state or index, and the
+  // garbage takes the old ones. if there are none, the list is cleared here.
+  Garbage* garbage = (reclaimer == 0) ? 0 : __garbage_create(list);
+  Node* head = 0;
+  void* state = 0;
+  HashIndex* index = 0;
+  bool ready = (garbage != 0);
+  if (ready && list->shares != 0) {
+    head = malloc(sizeof(*head));
+    ready = (head != 0);
+  } else if (ready && list->allocator.create != 0) {
+    state = list->allocator.create(list->node_size, list->allocator.arg);
+    ready = (state != 0);
+  }
+  if (ready && list->index != 0) {
+    index = index_create(list->index->hash);
+    ready = (index != 0);
+  }
+  if (!ready) {
+    if (state != 0 && list->allocator.destroy != 0) {
+      list->allocator.destroy(state);
+    }
+    index_destroy(index);
+    free(head);
+    free(garbage);
+    __list_clear(list);
+    return;
+  }
+
+  if (list->shares != 0) {
+    // copy-on-write copies keep the nodes, unless they all left already.
+    __drop_shares_async(list->head, list->shares, list->size, garbage);
+    head->data = 0;
+    head->next = head->prev = head;
+    list->head = list->iterator = head;
+    list->shares = 0;
+    list->size = 0;
+  } else {
+    // the allocator state goes along with its nodes, so that freeing them
+    // does not race with new nodes of the list.
+    __lock_all(list);
+    garbage->count = list->size;
+    garbage->chain = __detach_all(list);
+    if (state != 0) {
+      garbage->allocator_state = list->allocator_state;
+      garbage->own_state = true;
+      list->allocator_state = state;
+    }
+    __unlock_all(list);
   }
-
-  ListData * new_data = iterator->list->data_copy(val);
-  if (new_data == 0) {
-    return LIST_ITERATOR_NO_MEM;
+  if (index != 0) {
+    garbage->index = list->index;
+    list->index = index;
   }
 
-  iterator->list->data_free(iterator->node->data);
-  iterator->node->data = new_data;
-
-  return LIST_ITERATOR_SUCCESS;
+  __reclaimer_push(reclaimer, garbage);
 }
 
-void list_iterator_destroy(ListIterator iterator) {
-  if (iterator != 0) {
-    free(iterator);
+void list_destroy_async(List list, ListReclaimer reclaimer) {
+  if (list == 0) {
+    return;
   }
-}
 
-bool list_iterator_equal(const ListIterator first, const ListIterator second) {
-  if (first->node == second->node) {
-    return (first->start_edge == second->start_edge && first->end_edge == second->end_edge);
+  Garbage* garbage = (reclaimer == 0) ? 0 : __garbage_create(list);
+  if (garbage == 0) {
+    list_destroy(list);
+    return;
   }
 
-  return false;
+  if (list->shares != 0) {
+    // the head goes along with the shared nodes.
+    __drop_shares_async(list->head, list->shares, list->size, garbage);
+  } else {
+    garbage->count = list->size;
+    garbage->chain = __detach_chain(list);
+    free(list->head);
+  }
+  garbage->allocator_state = list->allocator_state;
+  garbage->own_state = true;
+  garbage->index = list->index;
+  __destroy_locks(list);
+  __destroy_rcu(list);
+  free(list);
+
+  __reclaimer_push(reclaimer, garbage);
 }
@@ -29,3 +29,24 @@ ListData * int_copy(const ListData* i) {
   *c = *(int*)i;
   return c;
 }
+
+size_t int_hash(const ListData * i) {
+  return (size_t)*(const int*)i * 2654435761u;
+}
+
+// Factories of lists of integers
+List int_list_create() {
+  return list_create(int_copy, int_free, int_compare);
+}
+
+List int_list_create_inline() {
+  return list_create_inline(sizeof(int), int_compare, list_malloc_allocator());
+}
+
+List int_list_create_slab() {
+  return list_create_with_allocator(int_copy, int_free, int_compare, list_slab_allocator());
+}
+
+List int_list_create_inline_slab() {
+  return list_create_inline(sizeof(int), int_compare, list_slab_allocator());
+}
@@ -13,3 +13,11 @@ ListData* string_copy(const ListData* s);
 int int_compare(const ListData * a, const ListData * b);
 void int_free(ListData* i);
 ListData * int_copy(const ListData* i);
+size_t int_hash(const ListData * i);
+
+// Factories of lists of integers, to run the same tests on every list mode
+typedef List(*IntListFactory)();
+List int_list_create();
+List int_list_create_inline();
+List int_list_create_slab();
+List int_list_create_inline_slab();
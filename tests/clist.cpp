@@ -0,0 +1,185 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "list.hpp"
+
+// counts the copies made of it, to tell copies from moves.
+struct Counted {
+  static int copies;
+  int value;
+  Counted(int v) : value(v) {}
+  Counted(const Counted & other) : value(other.value) {
+    ++copies;
+  }
+  Counted(Counted &&) = default;
+  bool operator<(const Counted & other) const {
+    return value < other.value;
+  }
+};
+int Counted::copies = 0;
+
+TEST(t_clist, general) {
+  clist::list<int> list;
+  EXPECT_TRUE(list.empty());
+  EXPECT_EQ(list.begin(), list.end());
+  for (int i = 0; i < 10; ++i) {
+    list.push_back(i);
+  }
+  list.push_front(-1);
+  list.emplace_front(-2);
+  EXPECT_EQ(12, list.size());
+  EXPECT_EQ(-2, list.front());
+  EXPECT_EQ(9, list.back());
+
+  int expected = -2;
+  for (int value : list) {
+    EXPECT_EQ(expected++, value);
+  }
+  for (auto it = list.rbegin(); it != list.rend(); ++it) {
+    EXPECT_EQ(--expected, *it);
+  }
+  EXPECT_EQ(10, std::distance(list.begin(), list.find(8)));
+  EXPECT_EQ(list.end(), list.find(42));
+
+  list.pop_front();
+  list.pop_back();
+  EXPECT_EQ(-1, list.front());
+  EXPECT_EQ(8, list.back());
+
+  clist::list<int> copy(list);
+  EXPECT_EQ(list, copy);
+  copy.front() = 100;
+  EXPECT_NE(list, copy);
+  clist::list<int> moved(std::move(copy));
+  EXPECT_TRUE(copy.empty());
+  EXPECT_EQ(100, moved.front());
+  copy = moved;
+  EXPECT_EQ(moved, copy);
+  list = std::move(moved);
+  EXPECT_EQ(copy, list);
+
+  list.clear();
+  EXPECT_TRUE(list.empty());
+  EXPECT_EQ(list.begin(), list.end());
+}
+
+// moving a list keeps its C list, so a growing vector moves the lists
+// instead of copying them.
+TEST(t_clist, move_keeps_handle) {
+  static_assert(std::is_nothrow_move_constructible<clist::list<int>>::value, "lists move without throwing");
+  std::vector<clist::list<int>> lists;
+  lists.emplace_back(std::initializer_list<int>{ 1, 2, 3 });
+  List handle = lists[0].handle();
+  for (int i = 0; i < 100; ++i) {
+    lists.emplace_back();
+  }
+  EXPECT_EQ(handle, lists[0].handle());
+  EXPECT_EQ((clist::list<int>{ 1, 2, 3 }), lists[0]);
+
+  // the moved-from list reads as empty, and takes a list again by assignment.
+  clist::list<int> moved(std::move(lists[0]));
+  EXPECT_EQ(handle, moved.handle());
+  EXPECT_EQ(nullptr, lists[0].handle());
+  EXPECT_TRUE(lists[0].empty());
+  EXPECT_EQ(lists[0].begin(), lists[0].end());
+  EXPECT_EQ(lists[0].end(), lists[0].find(1));
+  lists[0].sort();
+  lists[0].clear();
+  lists[0] = moved;
+  EXPECT_EQ(moved, lists[0]);
+  EXPECT_NE(handle, lists[0].handle());
+  lists[1] = std::move(moved);
+  EXPECT_EQ(handle, lists[1].handle());
+}
+
+TEST(t_clist, move_in) {
+  Counted::copies = 0;
+  clist::list<Counted> list;
+  for (int i = 0; i < 10; ++i) {
+    list.push_back(Counted(i));
+    list.emplace_front(-i);
+  }
+  EXPECT_EQ(0, Counted::copies);
+
+  clist::list<std::unique_ptr<int>> pointers;
+  pointers.push_back(std::make_unique<int>(1));
+  pointers.emplace_back(new int(2));
+  EXPECT_EQ(2, *pointers.back());
+  // the C list cannot copy elements which cannot be copied.
+  EXPECT_EQ(nullptr, list_copy(pointers.handle()));
+}
+
+TEST(t_clist, sort) {
+  clist::list<std::string> list = { "d", "b", "a", "c", "b" };
+  auto b = list.find("b");
+  list.sort();
+  EXPECT_EQ((clist::list<std::string>{ "a", "b", "b", "c", "d" }), list);
+  // iterators follow their nodes.
+  EXPECT_EQ(list.find("b"), b);
+  list.sort(std::greater<std::string>());
+  EXPECT_EQ((clist::list<std::string>{ "d", "c", "b", "b", "a" }), list);
+
+  // stable: equal elements keep their order.
+  clist::list<std::pair<int, int>> pairs;
+  for (int i = 0; i < 100; ++i) {
+    pairs.emplace_back(i % 3, i);
+  }
+  pairs.sort([](const std::pair<int, int> & x, const std::pair<int, int> & y) {
+    return x.first < y.first;
+  });
+  auto prev = pairs.front();
+  for (const auto & pair : pairs) {
+    if (pair.first == prev.first) {
+      EXPECT_LE(prev.second, pair.second);
+    }
+    EXPECT_LE(prev.first, pair.first);
+    prev = pair;
+  }
+}
+
+TEST(t_clist, pmr) {
+  std::vector<unsigned char> buffer(1 << 16);
+  std::pmr::monotonic_buffer_resource resource(buffer.data(), buffer.size(),
+                                               std::pmr::null_memory_resource());
+  {
+    // the buffer runs out before anything comes from elsewhere.
+    clist::pmr::list<int> list(&resource);
+    for (int i = 0; i < 100; ++i) {
+      list.push_back(i);
+    }
+    EXPECT_EQ(&resource, list.get_allocator().resource());
+
+    // lists with other resources take the elements one by one.
+    clist::pmr::list<int> other;
+    other = std::move(list);
+    EXPECT_EQ(100, other.size());
+    EXPECT_EQ(std::pmr::get_default_resource(), other.get_allocator().resource());
+  }
+}
+
+// the C functions work on the list under the wrapper.
+TEST(t_clist, handle) {
+  clist::list<int> list = { 3, 1, 2 };
+  List handle = list.handle();
+  EXPECT_EQ(3, list_get_size(handle));
+  int expected[] = { 3, 1, 2 };
+  int i = 0;
+  LIST_FOREACH_FORWARD(int*, value, handle) {
+    EXPECT_EQ(expected[i++], *value);
+  }
+
+  int value = 1;
+  EXPECT_EQ(1, *(const int*)list_find(handle, &value));
+  EXPECT_EQ(LIST_SUCCESS, list_sort(handle));
+  EXPECT_EQ((clist::list<int>{ 1, 2, 3 }), list);
+  EXPECT_EQ(LIST_SUCCESS, list_remove_at(handle, 0));
+  EXPECT_EQ(2, list.front());
+
+  List copy = list_copy(handle);
+  ASSERT_NE(nullptr, copy);
+  EXPECT_EQ(3, *(int*)list_get_last(copy, 0));
+  list_destroy(copy);
+}
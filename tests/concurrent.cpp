@@ -0,0 +1,296 @@
+#include <gtest/gtest.h>
+#include "ListTestTypes.hpp" // int_copy, int_free, int_compare
+#include <atomic>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include "list.h"
+}
+
+// checks that the links in both directions agree with the size of the list.
+static void expect_consistent(List list) {
+  size_t forward = 0, backward = 0;
+  LIST_FOREACH_FORWARD(int*, i, list) {
+    ++forward;
+  }
+  LIST_FOREACH_BACKWARD(int*, i, list) {
+    ++backward;
+  }
+  EXPECT_EQ(list_get_size(list), forward);
+  EXPECT_EQ(list_get_size(list), backward);
+}
+
+TEST(t_concurrent_list, create) {
+  List list = list_create_concurrent(int_copy, int_free, int_compare);
+  ASSERT_NE(nullptr, list);
+  EXPECT_EQ(nullptr, list_create_concurrent(nullptr, int_free, int_compare));
+  EXPECT_EQ(LIST_EINVAL, list_set_hash_index(list, [](const ListData * i) {
+    return (size_t)*(const int*)i;
+  }));
+
+  // a concurrent list is still a list
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(LIST_SUCCESS, list_push_front(list, &i));
+  }
+  EXPECT_EQ(LIST_SUCCESS, list_sort(list));
+  EXPECT_EQ(0, *(int*)list_get_first(list, 0));
+  EXPECT_EQ(9, *(int*)list_get_last(list, 0));
+  EXPECT_EQ(nullptr, list_get_next(list, 0));
+  EXPECT_EQ(5, *(int*)list_get_at(list, 5));
+  int value = 5;
+  EXPECT_EQ(LIST_SUCCESS, list_remove(list, &value));
+  EXPECT_EQ(nullptr, list_find(list, &value));
+
+  List copy = list_copy(list);
+  ASSERT_NE(nullptr, copy);
+  EXPECT_EQ(9, list_get_size(copy));
+  int* popped = (int*)list_pop_back(copy);
+  EXPECT_EQ(9, *popped);
+  int_free(popped);
+  expect_consistent(copy);
+  list_destroy(copy);
+
+  ListIterator it = list_iterator_create(list);
+  int expected = 0;
+  for (ListIteratorStatus stat = list_iterator_first(it); stat != LIST_ITERATOR_END; stat = list_iterator_next(it)) {
+    EXPECT_EQ(expected, *(int*)list_iterator_get(it));
+    expected += (expected == 4) ? 2 : 1;
+  }
+  list_iterator_destroy(it);
+  expect_consistent(list);
+  list_destroy(list);
+}
+
+TEST(t_concurrent_list, producers_consumers) {
+  List list = list_create_concurrent(int_copy, int_free, int_compare);
+  ASSERT_NE(nullptr, list);
+  const int threads = 4, per_thread = 20000;
+  std::vector<std::atomic<int>> seen(threads * per_thread);
+  std::atomic<int> consumed(0);
+
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([list, t]() {
+      for (int i = t * per_thread; i < (t + 1) * per_thread; ++i) {
+        if (i % 2 == 0) {
+          list_push_back(list, &i);
+        } else {
+          list_push_front(list, &i);
+        }
+      }
+    });
+    workers.emplace_back([list, t, &seen, &consumed]() {
+      while (consumed < threads * per_thread) {
+        int* value = (int*)(t % 2 == 0 ? list_pop_front(list) : list_pop_back(list));
+        if (value == nullptr) {
+          std::this_thread::yield();
+          continue;
+        }
+        ++seen[*value];
+        ++consumed;
+        int_free(value);
+      }
+    });
+  }
+  for (auto & worker : workers) {
+    worker.join();
+  }
+
+  for (auto & count : seen) {
+    EXPECT_EQ(1, count);
+  }
+  EXPECT_TRUE(list_empty(list));
+  expect_consistent(list);
+  list_destroy(list);
+}
+
+// every thread inserts and removes around its own marker node, which the
+// others never remove. neighbouring threads change the same links.
+TEST(t_concurrent_list, iterator_regions) {
+  List list = list_create_concurrent(int_copy, int_free, int_compare);
+  ASSERT_NE(nullptr, list);
+  const int threads = 8, rounds = 20000;
+  for (int t = 0; t < threads; ++t) {
+    list_push_back(list, &t);
+  }
+
+  // the markers are found before anything else moves
+  std::vector<ListIteratorStorage> markers(threads);
+  for (int t = 0; t < threads; ++t) {
+    ListIterator marker = list_iterator_init(&markers[t], list);
+    for (int i = 0; i < t; ++i) {
+      list_iterator_next(marker);
+    }
+  }
+
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([list, t, &markers]() {
+      ListIteratorStorage storage;
+      ListIterator marker = (ListIterator)&markers[t];
+      ASSERT_EQ(t, *(int*)list_iterator_get(marker));
+
+      int value = 1000 + t;
+      for (int round = 0; round < rounds; ++round) {
+        ListIterator it = list_iterator_init_copy(&storage, marker);
+        if (round % 2 == 0) {
+          ASSERT_EQ(LIST_SUCCESS, list_push_after(list, marker, &value));
+          list_iterator_next(it);
+        } else {
+          ASSERT_EQ(LIST_SUCCESS, list_push_before(list, marker, &value));
+          list_iterator_prev(it);
+        }
+        ASSERT_EQ(value, *(int*)list_iterator_get(it));
+        ASSERT_EQ(LIST_SUCCESS, list_remove_iterator(list, it));
+      }
+    });
+  }
+  // a thread locking the whole list meanwhile
+  workers.emplace_back([list]() {
+    for (int round = 0; round < 1000; ++round) {
+      int value = round % threads;
+      EXPECT_NE(nullptr, list_find(list, &value));
+      EXPECT_NE(nullptr, list_get_at(list, 0));
+    }
+  });
+  for (auto & worker : workers) {
+    worker.join();
+  }
+
+  ASSERT_EQ((size_t)threads, list_get_size(list));
+  int expected = 0;
+  ListIteratorStorage storage;
+  ListIterator it = list_iterator_init(&storage, list);
+  for (ListIteratorStatus stat = list_iterator_first(it); stat != LIST_ITERATOR_END; stat = list_iterator_next(it)) {
+    EXPECT_EQ(expected++, *(int*)list_iterator_get(it));
+  }
+  expect_consistent(list);
+  list_destroy(list);
+}
+
+// snapshots taken while a writer pushes hold the list as it was at one point,
+// i.e. a prefix of what the writer pushed.
+TEST(t_concurrent_list, snapshot) {
+  List lists[] = { list_create_concurrent(int_copy, int_free, int_compare),
+                   list_create_rcu(int_copy, int_free, int_compare) };
+  for (List list : lists) {
+    ASSERT_NE(nullptr, list);
+    const int count = 20000;
+    std::thread writer([list]() {
+      for (int i = 0; i < count; ++i) {
+        list_push_back(list, &i);
+      }
+    });
+    for (int round = 0; round < 50; ++round) {
+      List snapshot = list_snapshot(list);
+      ASSERT_NE(nullptr, snapshot);
+      int expected = 0;
+      LIST_FOREACH_FORWARD(int*, i, snapshot) {
+        ASSERT_EQ(expected++, *i);
+      }
+      EXPECT_EQ((size_t)expected, list_get_size(snapshot));
+      int value = 0;
+      EXPECT_EQ(LIST_EINVAL, list_push_back(snapshot, &value));
+      list_destroy(snapshot);
+    }
+    writer.join();
+    list_destroy(list);
+  }
+}
+
+// an element replaced through an iterator is freed while other threads
+// compare the elements in list_find.
+TEST(t_concurrent_list, set_find) {
+  List list = list_create_concurrent(int_copy, int_free, int_compare);
+  ASSERT_NE(nullptr, list);
+  for (int i = 0; i < 100; ++i) {
+    list_push_back(list, &i);
+  }
+
+  std::atomic<bool> done(false);
+  std::thread finder([list, &done]() {
+    int value = 50;
+    while (!done) {
+      EXPECT_NE(nullptr, list_find(list, &value));
+    }
+  });
+
+  ListIteratorStorage storage;
+  ListIterator it = list_iterator_init(&storage, list);
+  for (int round = 0; round < 20000; ++round) {
+    int value = (round % 2 == 0) ? 1000 + round : 0;
+    ASSERT_EQ(LIST_ITERATOR_SUCCESS, list_iterator_set(it, &value));
+    value = -round;
+    ASSERT_EQ(LIST_ITERATOR_SUCCESS, list_iterator_set_take(it, int_copy(&value)));
+  }
+  done = true;
+  finder.join();
+
+  EXPECT_EQ(-19999, *(int*)list_get_first(list, 0));
+  EXPECT_EQ(100, list_get_size(list));
+  list_destroy(list);
+}
+
+// the first and last elements are read while other threads pop and free the
+// nodes they are on.
+TEST(t_concurrent_list, get_pop) {
+  List list = list_create_concurrent(int_copy, int_free, int_compare);
+  ASSERT_NE(nullptr, list);
+  for (int i = 0; i < 100; ++i) {
+    list_push_back(list, &i);
+  }
+
+  std::atomic<bool> done(false);
+  std::thread reader([list, &done]() {
+    while (!done) {
+      // the list never runs out of elements.
+      EXPECT_NE(nullptr, list_get_first(list, 0));
+      EXPECT_NE(nullptr, list_get_last(list, 0));
+    }
+  });
+
+  for (int round = 0; round < 20000; ++round) {
+    int_free(list_pop_front(list));
+    int_free(list_pop_back(list));
+    list_push_back(list, &round);
+    list_push_front(list, &round);
+  }
+  done = true;
+  reader.join();
+
+  expect_consistent(list);
+  list_destroy(list);
+}
+
+// the hint of each writer ends on the element it inserted, while another
+// writer inserts next to it.
+TEST(t_concurrent_list, insert_sorted) {
+  List lists[] = { list_create_concurrent(int_copy, int_free, int_compare),
+                   list_create_rcu(int_copy, int_free, int_compare) };
+  for (List list : lists) {
+    ASSERT_NE(nullptr, list);
+    const int count = 5000;
+    std::vector<std::thread> writers;
+    for (int w = 0; w < 2; ++w) {
+      writers.emplace_back([list, w]() {
+        ListIteratorStorage storage;
+        ListIterator hint = list_iterator_init(&storage, list);
+        for (int i = w; i < 2 * count; i += 2) {
+          ASSERT_EQ(LIST_SUCCESS, list_insert_sorted(list, &i, hint));
+          EXPECT_EQ(i, *(int*)list_iterator_get(hint));
+        }
+      });
+    }
+    for (auto & writer : writers) {
+      writer.join();
+    }
+
+    int expected = 0;
+    LIST_FOREACH_FORWARD(int*, i, list) {
+      EXPECT_EQ(expected++, *i);
+    }
+    EXPECT_EQ(2 * count, expected);
+    list_destroy(list);
+  }
+}
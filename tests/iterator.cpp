@@ -5,8 +5,11 @@ extern "C" {
 #include "list.h"
 }
 
-TEST(t_list_iterator, general) {
-  List list = list_create(int_copy, int_free, int_compare);
+// the tests of lists of integers run on every list mode
+class t_int_list_iterator : public ::testing::TestWithParam<IntListFactory> {};
+
+TEST_P(t_int_list_iterator, general) {
+  List list = GetParam()();
   ListIterator iterator = list_iterator_create(list);
   ASSERT_NE(list, nullptr);
   ASSERT_NE(iterator, nullptr);
@@ -132,6 +135,50 @@ TEST(t_list_iterator, general) {
   list_destroy(list);
 }
 
+INSTANTIATE_TEST_SUITE_P(modes, t_int_list_iterator,
+                         ::testing::Values(int_list_create, int_list_create_inline,
+                                           int_list_create_slab, int_list_create_inline_slab));
+
+TEST_P(t_int_list_iterator, storage) {
+  List list = GetParam()();
+  for (int i = 0; i < 5; ++i) {
+    list_push_back(list, &i);
+  }
+
+  ListIteratorStorage storage, copy_storage;
+  EXPECT_EQ(nullptr, list_iterator_init(nullptr, list));
+  EXPECT_EQ(nullptr, list_iterator_init(&storage, nullptr));
+  ListIterator iterator = list_iterator_init(&storage, list);
+  ASSERT_NE(nullptr, iterator);
+  EXPECT_EQ(0, *(int*)list_iterator_get(iterator));
+  EXPECT_EQ(LIST_ITERATOR_SUCCESS, list_iterator_next(iterator));
+
+  ListIterator copy = list_iterator_init_copy(&copy_storage, iterator);
+  ASSERT_NE(nullptr, copy);
+  EXPECT_TRUE(list_iterator_equal(iterator, copy));
+  EXPECT_EQ(LIST_ITERATOR_SUCCESS, list_iterator_next(copy));
+  EXPECT_EQ(2, *(int*)list_iterator_get(copy));
+  EXPECT_EQ(1, *(int*)list_iterator_get(iterator));
+
+  // heap and storage iterators mix freely
+  ListIterator heap = list_iterator_copy(copy);
+  EXPECT_TRUE(list_iterator_equal(heap, copy));
+  EXPECT_EQ(LIST_SUCCESS, list_remove_iterator(list, heap));
+  EXPECT_EQ(3, *(int*)list_iterator_get(heap));
+  list_iterator_destroy(heap);
+
+  int sum = 0;
+  for (ListIteratorStatus stat = list_iterator_first(iterator); stat != LIST_ITERATOR_END; stat = list_iterator_next(iterator)) {
+    sum += *(int*)list_iterator_get(iterator);
+  }
+  EXPECT_EQ(8, sum);
+
+  // does nothing
+  list_iterator_destroy(iterator);
+  list_iterator_destroy(copy);
+  list_destroy(list);
+}
+
 TEST(t_list_iterator, set) {
   List list = list_create(string_copy, string_free, string_compare);
   ASSERT_NE(list, nullptr);
@@ -1,6 +1,10 @@
 #include <gtest/gtest.h>
 #include "ListTestTypes.hpp"
+#include <atomic>
+#include <functional>
 #include <string>
+#include <thread>
+#include <vector>
 
 extern "C" {
 #include "list.h"
@@ -57,8 +61,11 @@ TEST(t_list, general_correctness) {
   list_destroy(list);
 }
 
-TEST(t_list, sort) {
-  List list = list_create(int_copy, int_free, int_compare);
+// the tests of lists of integers run on every list mode
+class t_int_list : public ::testing::TestWithParam<IntListFactory> {};
+
+TEST_P(t_int_list, sort) {
+  List list = GetParam()();
   ASSERT_NE(list, nullptr);
   for (size_t i = 0; i < 50; ++i) {
     int tmp = i % 11;
@@ -75,10 +82,10 @@ TEST(t_list, sort) {
   list_destroy(list);
 }
 
-TEST(t_list, find) {
+TEST_P(t_int_list, find) {
   int num[] = { 15, 17, -1, 3, 19, 4 };
   size_t num_size = sizeof(num) / sizeof(num[0]);
-  List list = list_create(int_copy, int_free, int_compare);
+  List list = GetParam()();
   ASSERT_NE(list, nullptr);
   for (size_t i = 0; i < num_size; ++i) {
     EXPECT_EQ(LIST_SUCCESS, list_push_back(list, &num[i]));
@@ -93,8 +100,8 @@ TEST(t_list, find) {
   list_destroy(list);
 }
 
-TEST(t_list, push_at) {
-  List list = list_create(int_copy, int_free, int_compare);
+TEST_P(t_int_list, push_at) {
+  List list = GetParam()();
   ASSERT_NE(list, nullptr);
   int num[] = { 1, 2, 4, 5, 6 };
   size_t num_size = sizeof(num) / sizeof(num[0]);
@@ -110,11 +117,15 @@ TEST(t_list, push_at) {
     EXPECT_EQ(i++, *iterator);
   }
 
+  LIST_FOREACH_BACKWARD(int*, iterator, list) {
+    EXPECT_EQ(--i, *iterator);
+  }
+
   list_destroy(list);
 }
 
-TEST(t_list, remove_at) {
-  List list = list_create(int_copy, int_free, int_compare);
+TEST_P(t_int_list, remove_at) {
+  List list = GetParam()();
   ASSERT_NE(list, nullptr);
   int num[] = { 0, 1, 2, 3, 4, 5, 6 };
   size_t num_size = sizeof(num) / sizeof(num[0]);
@@ -144,8 +155,8 @@ TEST(t_list, remove_at) {
   list_destroy(list);
 }
 
-TEST(t_list, get_at) {
-  List list = list_create(int_copy, int_free, int_compare);
+TEST_P(t_int_list, get_at) {
+  List list = GetParam()();
   ASSERT_NE(list, nullptr);
   int num[] = { 0, 1, 2, 3, 4, 5, 6 };
   size_t num_size = sizeof(num) / sizeof(num[0]);
@@ -160,8 +171,8 @@ TEST(t_list, get_at) {
   list_destroy(list);
 }
 
-TEST(t_list, pop_and_push) {
-  List list = list_create(int_copy, int_free, int_compare);
+TEST_P(t_int_list, pop_and_push) {
+  List list = GetParam()();
   ASSERT_NE(list, nullptr);
   for (size_t i = 0; i < 50; ++i) {
     EXPECT_EQ(LIST_SUCCESS, list_push_back(list, &i));
@@ -187,3 +198,1345 @@ TEST(t_list, pop_and_push) {
   list_iterator_destroy(iterator);
   list_destroy(list);
 }
+
+INSTANTIATE_TEST_SUITE_P(modes, t_int_list,
+                         ::testing::Values(int_list_create, int_list_create_inline,
+                                           int_list_create_slab, int_list_create_inline_slab));
+
+TEST(t_list, slab_allocator) {
+  List list = list_create_with_allocator(int_copy, int_free, int_compare, list_slab_allocator());
+  ASSERT_NE(list, nullptr);
+  for (int i = 0; i < 10000; ++i) {
+    EXPECT_EQ(LIST_SUCCESS, list_push_back(list, &i));
+  }
+  EXPECT_EQ(10000, list_get_size(list));
+
+  // removed nodes are recycled by the following pushes
+  for (int i = 0; i < 5000; ++i) {
+    int_free(list_pop_front(list));
+  }
+  for (int i = 0; i < 5000; ++i) {
+    EXPECT_EQ(LIST_SUCCESS, list_push_front(list, &i));
+  }
+  EXPECT_EQ(4999, *(int*)list_get_first(list, 0));
+  EXPECT_EQ(9999, *(int*)list_get_last(list, 0));
+
+  List copy = list_copy(list);
+  ASSERT_NE(copy, nullptr);
+  EXPECT_EQ(LIST_SUCCESS, list_sort(copy));
+  EXPECT_EQ(0, *(int*)list_get_first(copy, 0));
+  list_destroy(copy);
+
+  list_clear(list);
+  EXPECT_TRUE(list_empty(list));
+  int i = 7;
+  EXPECT_EQ(LIST_SUCCESS, list_push_back(list, &i));
+  EXPECT_EQ(7, *(int*)list_get_first(list, 0));
+
+  list_destroy(list);
+}
+
+struct CountingAllocator {
+  int live = 0;
+};
+
+static void * counting_create(size_t, void * arg) {
+  return arg;
+}
+
+static void * counting_alloc(void * state, size_t node_size) {
+  ++static_cast<CountingAllocator*>(state)->live;
+  return malloc(node_size);
+}
+
+static void counting_free(void * state, void * node) {
+  --static_cast<CountingAllocator*>(state)->live;
+  free(node);
+}
+
+TEST(t_list, custom_allocator) {
+  CountingAllocator counter;
+  ListAllocator allocator = { counting_create, nullptr, counting_alloc, counting_free, nullptr, &counter };
+  List list = list_create_with_allocator(int_copy, int_free, int_compare, &allocator);
+  ASSERT_NE(list, nullptr);
+  for (int i = 0; i < 10; ++i) {
+    list_push_back(list, &i);
+  }
+  EXPECT_EQ(10, counter.live);
+  EXPECT_EQ(LIST_SUCCESS, list_remove_at(list, 3));
+  EXPECT_EQ(9, counter.live);
+  list_destroy(list);
+  EXPECT_EQ(0, counter.live);
+
+  allocator.alloc = nullptr;
+  EXPECT_EQ(nullptr, list_create_with_allocator(int_copy, int_free, int_compare, &allocator));
+}
+
+TEST(t_list, take) {
+  List list = list_create(int_copy, int_free, int_compare);
+  ASSERT_NE(list, nullptr);
+  for (int i = 0; i < 5; ++i) {
+    int * item = (int*)malloc(sizeof(*item));
+    *item = i;
+    ASSERT_EQ(LIST_SUCCESS, list_push_back_take(list, item));
+    // the list holds the very same element
+    EXPECT_EQ(item, list_get_last(list, 0));
+  }
+  int * item = (int*)malloc(sizeof(*item));
+  *item = -1;
+  EXPECT_EQ(LIST_SUCCESS, list_push_front_take(list, item));
+  EXPECT_EQ(LIST_EINVAL, list_push_at_take(list, 7, item));
+  EXPECT_EQ(LIST_EINVAL, list_push_back_take(list, nullptr));
+
+  int three = 3;
+  int * extracted = (int*)list_remove_take(list, &three);
+  ASSERT_NE(extracted, nullptr);
+  EXPECT_EQ(3, *extracted);
+  EXPECT_EQ(5, list_get_size(list));
+  EXPECT_EQ(nullptr, list_remove_take(list, &three));
+  EXPECT_EQ(LIST_NOT_FOUND, list_remove(list, &three));
+  EXPECT_EQ(LIST_SUCCESS, list_push_at_take(list, 4, extracted));
+
+  extracted = (int*)list_remove_at_take(list, 0);
+  ASSERT_NE(extracted, nullptr);
+  EXPECT_EQ(-1, *extracted);
+  *extracted = 10;
+  ListIterator iterator = list_iterator_create(list);
+  EXPECT_EQ(LIST_ITERATOR_SUCCESS, list_iterator_set_take(iterator, extracted));
+
+  int res[] = { 10, 1, 2, 3, 4 };
+  size_t i = 0;
+  LIST_FOREACH_FORWARD(int*, it, list) {
+    EXPECT_EQ(res[i++], *it);
+  }
+
+  list_iterator_end(iterator);
+  EXPECT_EQ(LIST_ITERATOR_EINVAL, list_iterator_set_take(iterator, &three));
+
+  list_iterator_destroy(iterator);
+  list_destroy(list);
+}
+
+struct Point {
+  double x, y;
+};
+
+static int point_compare(const ListData * a, const ListData * b) {
+  const Point * p = (const Point*)a, * q = (const Point*)b;
+  return (p->x > q->x) - (p->x < q->x);
+}
+
+TEST(t_list, inline_elements) {
+  List list = list_create_inline(sizeof(Point), point_compare, list_slab_allocator());
+  ASSERT_NE(list, nullptr);
+  EXPECT_EQ(nullptr, list_create_inline(0, point_compare, list_slab_allocator()));
+  for (int i = 0; i < 100; ++i) {
+    Point p = { (double)(i % 7), (double)i };
+    ASSERT_EQ(LIST_SUCCESS, list_push_back(list, &p));
+  }
+
+  // elements are stored in the nodes, so they are suitably aligned and stable
+  Point * first = (Point*)list_get_first(list, 0);
+  EXPECT_EQ(0, (uintptr_t)first % alignof(Point));
+  EXPECT_EQ(first, list_get_at(list, 0));
+
+  // sort is stable
+  ASSERT_EQ(LIST_SUCCESS, list_sort(list));
+  double prev_x = -1, prev_y = -1;
+  LIST_FOREACH_FORWARD(Point*, p, list) {
+    if (p->x == prev_x) {
+      EXPECT_LT(prev_y, p->y);
+    } else {
+      EXPECT_LT(prev_x, p->x);
+    }
+    prev_x = p->x;
+    prev_y = p->y;
+  }
+
+  // extracted elements are heap copies
+  Point * popped = (Point*)list_pop_back(list);
+  ASSERT_NE(popped, nullptr);
+  EXPECT_EQ(6, popped->x);
+  popped->x = -1;
+  ASSERT_EQ(LIST_SUCCESS, list_push_front_take(list, popped));
+  EXPECT_EQ(-1, ((Point*)list_get_first(list, 0))->x);
+  EXPECT_EQ(100, list_get_size(list));
+
+  List copy = list_copy(list);
+  ASSERT_NE(copy, nullptr);
+  EXPECT_EQ(100, list_get_size(copy));
+  EXPECT_NE(list_get_first(list, 0), list_get_first(copy, 0));
+  EXPECT_EQ(-1, ((Point*)list_get_first(copy, 0))->x);
+  list_destroy(copy);
+
+  list_destroy(list);
+}
+
+static int first_char_compare(const ListData * a, const ListData * b) {
+  return *(const char*)a - *(const char*)b;
+}
+
+TEST(t_list, sort_stable) {
+  List list = list_create(string_copy, string_free, first_char_compare);
+  ASSERT_NE(list, nullptr);
+  EXPECT_EQ(LIST_SUCCESS, list_sort(list));
+  for (int i = 0; i < 1000; ++i) {
+    std::string s = std::string(1, 'a' + (i * 7) % 26) + std::to_string(i);
+    list_push_back(list, s.c_str());
+  }
+  ListData * first = list_get_first(list, 0);
+
+  EXPECT_EQ(LIST_SUCCESS, list_sort(list));
+  EXPECT_EQ(1000, list_get_size(list));
+  std::string prev;
+  LIST_FOREACH_FORWARD(char*, s, list) {
+    if (!prev.empty() && prev[0] == s[0]) {
+      EXPECT_LT(std::stoi(prev.substr(1)), std::stoi(s + 1));
+    } else if (!prev.empty()) {
+      EXPECT_LT(prev[0], s[0]);
+    }
+    prev = s;
+  }
+  LIST_FOREACH_BACKWARD(char*, s, list) {
+    EXPECT_LE(s[0], prev[0]);
+    prev = s;
+  }
+
+  // the elements were not copied
+  EXPECT_EQ(first, list_get_first(list, 0));
+
+  list_destroy(list);
+}
+
+TEST(t_list, sort_parallel) {
+  List list = list_create(string_copy, string_free, first_char_compare);
+  ASSERT_NE(list, nullptr);
+  EXPECT_EQ(LIST_EINVAL, list_sort_parallel(list, 0));
+  for (int i = 0; i < 20000; ++i) {
+    std::string s = std::string(1, 'a' + (i * 7919) % 26) + std::to_string(i);
+    list_push_back(list, s.c_str());
+  }
+
+  List expected = list_copy(list);
+  ASSERT_NE(expected, nullptr);
+  ASSERT_EQ(LIST_SUCCESS, list_sort(expected));
+  for (unsigned threads = 1; threads <= 7; ++threads) {
+    List sorted = list_copy(list);
+    ASSERT_NE(sorted, nullptr);
+    ASSERT_EQ(LIST_SUCCESS, list_sort_parallel(sorted, threads));
+    ASSERT_EQ(list_get_size(expected), list_get_size(sorted));
+
+    // identical to list_sort, including the order of equal elements
+    ListIterator it = list_iterator_create(sorted);
+    LIST_FOREACH_FORWARD(char*, s, expected) {
+      ASSERT_STREQ(s, (char*)list_iterator_get(it));
+      list_iterator_next(it);
+    }
+    list_iterator_destroy(it);
+    EXPECT_STREQ((char*)list_get_last(expected, 0), (char*)list_get_last(sorted, 0));
+    list_destroy(sorted);
+  }
+
+  list_destroy(expected);
+  list_destroy(list);
+}
+
+static uint64_t int_key(const ListData * i) {
+  // flip the sign bit, so negative numbers come first
+  return (uint64_t)(uint32_t)*(const int*)i ^ 0x80000000u;
+}
+
+// the first 2 characters only, so there are plenty of equal keys
+static uint64_t string_prefix_key(const ListData * s) {
+  const unsigned char * c = (const unsigned char*)s;
+  uint64_t key = (uint64_t)c[0] << 56;
+  if (c[0] != 0) {
+    key |= (uint64_t)c[1] << 48;
+  }
+  return key;
+}
+
+TEST_P(t_int_list, sort_by_key) {
+  List list = GetParam()();
+  ASSERT_NE(list, nullptr);
+  EXPECT_EQ(LIST_EINVAL, list_sort_by_key(list, nullptr));
+  for (int i = 0; i < 1000; ++i) {
+    int tmp = (i * 7919) % 2001 - 1000;
+    list_push_front(list, &tmp);
+  }
+
+  ASSERT_EQ(LIST_SUCCESS, list_sort_by_key(list, int_key));
+  EXPECT_EQ(1000, list_get_size(list));
+  int prev = -1001;
+  LIST_FOREACH_FORWARD(int*, iterator, list) {
+    EXPECT_LE(prev, *iterator);
+    prev = *iterator;
+  }
+  LIST_FOREACH_BACKWARD(int*, iterator, list) {
+    EXPECT_GE(prev, *iterator);
+    prev = *iterator;
+  }
+
+  list_destroy(list);
+}
+
+TEST(t_list, sort_by_key_ties) {
+  List list = list_create(string_copy, string_free, string_compare);
+  ASSERT_NE(list, nullptr);
+  for (int i = 0; i < 5000; ++i) {
+    std::string s = std::to_string((i * 7919) % 5000);
+    list_push_back(list, s.c_str());
+  }
+  list_push_back(list, "");
+
+  List expected = list_copy(list);
+  ASSERT_NE(expected, nullptr);
+  ASSERT_EQ(LIST_SUCCESS, list_sort(expected));
+  ASSERT_EQ(LIST_SUCCESS, list_sort_by_key(list, string_prefix_key));
+  ASSERT_EQ(list_get_size(expected), list_get_size(list));
+  ListIterator it = list_iterator_create(list);
+  LIST_FOREACH_FORWARD(char*, s, expected) {
+    ASSERT_STREQ(s, (char*)list_iterator_get(it));
+    list_iterator_next(it);
+  }
+
+  list_iterator_destroy(it);
+  list_destroy(expected);
+  list_destroy(list);
+}
+
+TEST_P(t_int_list, hash_index) {
+  List list = GetParam()();
+  ASSERT_NE(list, nullptr);
+  for (int i = 0; i < 100; ++i) {
+    list_push_back(list, &i);
+  }
+  EXPECT_EQ(LIST_EINVAL, list_set_hash_index(nullptr, int_hash));
+  ASSERT_EQ(LIST_SUCCESS, list_set_hash_index(list, int_hash));
+
+  for (int i = 100; i < 2000; ++i) {
+    ASSERT_EQ(LIST_SUCCESS, (i % 2) ? list_push_back(list, &i) : list_push_front(list, &i));
+  }
+  for (int i = 0; i < 2000; ++i) {
+    const int * found = (const int*)list_find(list, &i);
+    ASSERT_NE(found, nullptr);
+    EXPECT_EQ(i, *found);
+  }
+  int missing = 2000;
+  EXPECT_EQ(nullptr, list_find(list, &missing));
+  EXPECT_EQ(LIST_NOT_FOUND, list_remove(list, &missing));
+
+  // remove every element divisible by 3
+  for (int i = 0; i < 2000; i += 3) {
+    ASSERT_EQ(LIST_SUCCESS, list_remove(list, &i));
+  }
+  int_free(list_pop_front(list));
+  int_free(list_pop_back(list));
+  EXPECT_EQ(LIST_SUCCESS, list_remove_at(list, 10));
+  size_t count = 0;
+  LIST_FOREACH_FORWARD(int*, i, list) {
+    EXPECT_EQ(i, list_find(list, i));
+    ++count;
+  }
+  EXPECT_EQ(count, list_get_size(list));
+  for (int i = 0; i < 2000; i += 3) {
+    EXPECT_EQ(nullptr, list_find(list, &i));
+  }
+
+  // the index follows values changed through iterators and sorting
+  ListIterator iterator = list_iterator_create(list);
+  int old_value = *(int*)list_iterator_get(iterator);
+  int new_value = 5000;
+  ASSERT_EQ(LIST_ITERATOR_SUCCESS, list_iterator_set(iterator, &new_value));
+  EXPECT_EQ(nullptr, list_find(list, &old_value));
+  EXPECT_EQ(list_iterator_get(iterator), list_find(list, &new_value));
+  list_iterator_destroy(iterator);
+  ASSERT_EQ(LIST_SUCCESS, list_sort(list));
+  EXPECT_EQ(list_get_last(list, 0), list_find(list, &new_value));
+
+  // with duplicates, list_remove removes the first one in forward order
+  int dup = 7;
+  ASSERT_EQ(LIST_SUCCESS, list_push_at(list, 0, &dup));
+  ASSERT_EQ(LIST_SUCCESS, list_remove(list, &dup));
+  EXPECT_NE(7, *(int*)list_get_first(list, 0));
+  EXPECT_NE(nullptr, list_find(list, &dup));
+
+  List copy = list_copy(list);
+  ASSERT_NE(copy, nullptr);
+  EXPECT_EQ(LIST_SUCCESS, list_remove(copy, &new_value));
+  EXPECT_EQ(nullptr, list_find(copy, &new_value));
+  EXPECT_NE(nullptr, list_find(list, &new_value));
+  list_destroy(copy);
+
+  list_clear(list);
+  EXPECT_EQ(nullptr, list_find(list, &dup));
+  ASSERT_EQ(LIST_SUCCESS, list_push_back(list, &dup));
+  EXPECT_NE(nullptr, list_find(list, &dup));
+
+  ASSERT_EQ(LIST_SUCCESS, list_set_hash_index(list, nullptr));
+  EXPECT_NE(nullptr, list_find(list, &dup));
+
+  list_destroy(list);
+}
+
+TEST_P(t_int_list, positional) {
+  List list = GetParam()();
+  ASSERT_NE(list, nullptr);
+  for (int i = 0; i < 101; i += 2) {
+    ASSERT_EQ(LIST_SUCCESS, list_push_back(list, &i));
+  }
+  // fill in the odd numbers, in both halves of the list
+  for (int i = 1; i < 101; i += 2) {
+    ASSERT_EQ(LIST_SUCCESS, list_push_at(list, i, &i));
+  }
+  ASSERT_EQ(101, list_get_size(list));
+  for (int i = 0; i < 101; ++i) {
+    ASSERT_EQ(i, *(int*)list_get_at(list, i));
+  }
+  EXPECT_EQ(nullptr, list_get_at(list, 101));
+  EXPECT_EQ(nullptr, list_get_at(nullptr, 0));
+
+  EXPECT_EQ(LIST_SUCCESS, list_remove_at(list, 90));
+  EXPECT_EQ(LIST_SUCCESS, list_remove_at(list, 10));
+  EXPECT_EQ(91, *(int*)list_get_at(list, 89));
+  EXPECT_EQ(11, *(int*)list_get_at(list, 10));
+  EXPECT_EQ(LIST_EINVAL, list_remove_at(list, 99));
+  int value = 1000;
+  EXPECT_EQ(LIST_SUCCESS, list_push_at(list, 99, &value));
+  EXPECT_EQ(1000, *(int*)list_get_last(list, 0));
+
+  list_destroy(list);
+}
+
+TEST_P(t_int_list, compact) {
+  List list = GetParam()();
+  ASSERT_NE(list, nullptr);
+  EXPECT_EQ(LIST_EINVAL, list_compact(nullptr));
+  EXPECT_EQ(LIST_SUCCESS, list_compact(list));
+  for (int i = 0; i < 1000; ++i) {
+    int tmp = (i * 7919) % 1000;
+    list_push_back(list, &tmp);
+  }
+  for (int i = 0; i < 1000; i += 4) {
+    list_remove(list, &i);
+  }
+  ASSERT_EQ(LIST_SUCCESS, list_set_hash_index(list, int_hash));
+  ASSERT_EQ(LIST_SUCCESS, list_sort(list));
+
+  ASSERT_EQ(LIST_SUCCESS, list_compact(list));
+  EXPECT_EQ(750, list_get_size(list));
+  int prev = -1;
+  LIST_FOREACH_FORWARD(int*, i, list) {
+    EXPECT_LT(prev, *i);
+    EXPECT_NE(0, *i % 4);
+    EXPECT_EQ(i, list_find(list, i));
+    prev = *i;
+  }
+  LIST_FOREACH_BACKWARD(int*, i, list) {
+    EXPECT_GE(prev, *i);
+    prev = *i;
+  }
+
+  // the list is fully usable afterwards
+  int value = 4;
+  EXPECT_EQ(LIST_SUCCESS, list_push_at(list, 3, &value));
+  EXPECT_EQ(4, *(int*)list_get_at(list, 3));
+  EXPECT_EQ(LIST_SUCCESS, list_remove(list, &value));
+  list_clear(list);
+  EXPECT_EQ(LIST_SUCCESS, list_compact(list));
+  EXPECT_TRUE(list_empty(list));
+
+  list_destroy(list);
+}
+
+TEST_P(t_int_list, cursor) {
+  List list = GetParam()();
+  ListCursor cursor;
+  EXPECT_EQ(nullptr, list_cursor_first(list, &cursor));
+  EXPECT_EQ(nullptr, list_cursor_next(list, &cursor));
+  EXPECT_EQ(nullptr, list_cursor_last(list, &cursor));
+  EXPECT_EQ(nullptr, list_cursor_prev(list, &cursor));
+  EXPECT_EQ(nullptr, list_cursor_first(nullptr, &cursor));
+  EXPECT_EQ(nullptr, list_cursor_first(list, nullptr));
+
+  for (int i = 0; i < 3; ++i) {
+    list_push_back(list, &i);
+  }
+  EXPECT_EQ(0, *(int*)list_cursor_first(list, &cursor));
+  EXPECT_EQ(1, *(int*)list_cursor_next(list, &cursor));
+  EXPECT_EQ(0, *(int*)list_cursor_prev(list, &cursor));
+  EXPECT_EQ(nullptr, list_cursor_prev(list, &cursor));
+  // a cursor which passed an edge stays there
+  EXPECT_EQ(nullptr, list_cursor_next(list, &cursor));
+  EXPECT_EQ(2, *(int*)list_cursor_last(list, &cursor));
+  EXPECT_EQ(nullptr, list_cursor_next(list, &cursor));
+  EXPECT_EQ(nullptr, list_cursor_prev(list, &cursor));
+
+  // cursors leave the position of list_get_next alone
+  EXPECT_EQ(0, *(int*)list_get_first(list, 0));
+  list_cursor_last(list, &cursor);
+  EXPECT_EQ(1, *(int*)list_get_next(list, 0));
+
+  list_destroy(list);
+}
+
+TEST_P(t_int_list, nested_foreach) {
+  List list = GetParam()();
+  for (int i = 0; i < 10; ++i) {
+    list_push_back(list, &i);
+  }
+
+  int pairs = 0;
+  LIST_FOREACH_FORWARD(int*, i, list) {
+    LIST_FOREACH_BACKWARD(int*, j, list) {
+      if (*j < *i) {
+        break;
+      }
+      ++pairs;
+    }
+  }
+  EXPECT_EQ(55, pairs);
+
+  list_destroy(list);
+}
+
+TEST(t_list, concurrent_readers) {
+  List list = list_create(int_copy, int_free, int_compare);
+  const int size = 10000;
+  for (int i = 0; i < size; ++i) {
+    list_push_back(list, &i);
+  }
+
+  std::vector<long> sums(8);
+  std::vector<std::thread> readers;
+  for (size_t t = 0; t < sums.size(); ++t) {
+    readers.emplace_back([list, &sums, t]() {
+      for (int round = 0; round < 10; ++round) {
+        LIST_FOREACH_FORWARD(int*, i, list) {
+          sums[t] += *i;
+        }
+        LIST_FOREACH_BACKWARD(int*, i, list) {
+          sums[t] -= *i;
+        }
+        sums[t] += (long)list_get_size(list);
+      }
+    });
+  }
+  for (auto & reader : readers) {
+    reader.join();
+  }
+  for (long sum : sums) {
+    EXPECT_EQ(10L * size, sum);
+  }
+
+  list_destroy(list);
+}
+
+static std::vector<int> int_contents(List list) {
+  std::vector<int> contents;
+  LIST_FOREACH_FORWARD(int*, i, list) {
+    contents.push_back(*i);
+  }
+  // the links agree backwards
+  size_t n = contents.size();
+  LIST_FOREACH_BACKWARD(int*, i, list) {
+    EXPECT_EQ(contents[--n], *i);
+  }
+  EXPECT_EQ(contents.size(), list_get_size(list));
+  return contents;
+}
+
+// slab lists allocate nodes from a state of their own, so their nodes do not
+// move to other lists.
+static bool moves_between_lists(IntListFactory create) {
+  return create != int_list_create_slab && create != int_list_create_inline_slab;
+}
+
+TEST_P(t_int_list, splice) {
+  List a = GetParam()(), b = GetParam()();
+  ASSERT_NE(a, nullptr);
+  ASSERT_NE(b, nullptr);
+  for (int i = 0; i < 10; ++i) {
+    list_push_back(a, &i);
+    int value = 100 + i;
+    list_push_back(b, &value);
+  }
+
+  // a range of b, 102..104, into a before 5
+  ListIteratorStorage storage[3];
+  ListIterator position = list_iterator_init(&storage[0], a);
+  ListIterator first = list_iterator_init(&storage[1], b);
+  ListIterator last = list_iterator_init(&storage[2], b);
+  for (int i = 0; i < 5; ++i) {
+    list_iterator_next(position);
+  }
+  list_iterator_next(first);
+  list_iterator_next(first);
+  for (int i = 0; i < 5; ++i) {
+    list_iterator_next(last);
+  }
+  EXPECT_EQ(LIST_EINVAL, list_splice(a, position, b, last, first));
+  EXPECT_EQ(LIST_EINVAL, list_splice(a, first, b, first, last));
+  if (!moves_between_lists(GetParam())) {
+    EXPECT_EQ(LIST_EINVAL, list_splice(a, position, b, first, last));
+    EXPECT_EQ(10, list_get_size(a));
+    EXPECT_EQ(10, list_get_size(b));
+    list_destroy(a);
+    list_destroy(b);
+    return;
+  }
+  ListIteratorStorage second_storage;
+  ListIterator second = list_iterator_init_copy(&second_storage, first);
+  list_iterator_next(second);
+  ASSERT_EQ(LIST_SUCCESS, list_splice(a, position, b, first, last));
+  EXPECT_EQ(std::vector<int>({ 0, 1, 2, 3, 4, 102, 103, 104, 5, 6, 7, 8, 9 }), int_contents(a));
+  EXPECT_EQ(std::vector<int>({ 100, 101, 105, 106, 107, 108, 109 }), int_contents(b));
+  // another iterator of a moved element goes on up to the end of a, and is
+  // reset in b.
+  std::vector<int> rest_of_a;
+  for (ListIteratorStatus status = LIST_ITERATOR_SUCCESS; status == LIST_ITERATOR_SUCCESS;
+       status = list_iterator_next(second)) {
+    rest_of_a.push_back(*(int*)list_iterator_get(second));
+  }
+  EXPECT_EQ(std::vector<int>({ 103, 104, 5, 6, 7, 8, 9 }), rest_of_a);
+  EXPECT_EQ(nullptr, list_iterator_get(second));
+  EXPECT_EQ(LIST_ITERATOR_SUCCESS, list_iterator_first(second));
+  EXPECT_EQ(100, *(int*)list_iterator_get(second));
+  // the iterators still work in their lists
+  EXPECT_EQ(102, *(int*)list_iterator_get(first));
+  EXPECT_EQ(LIST_SUCCESS, list_remove_iterator(a, first));
+  EXPECT_EQ(103, *(int*)list_iterator_get(first));
+  EXPECT_EQ(105, *(int*)list_iterator_get(last));
+
+  // the rest of b to the back of a
+  ListIterator rest = list_iterator_init(&storage[1], b);
+  EXPECT_EQ(LIST_SUCCESS, list_splice(a, 0, b, rest, 0));
+  EXPECT_TRUE(list_empty(b));
+  EXPECT_EQ(19, list_get_size(a));
+  EXPECT_EQ(109, *(int*)list_get_last(a, 0));
+
+  // an empty range
+  ListIterator end = list_iterator_init(&storage[2], b);
+  EXPECT_EQ(LIST_SUCCESS, list_splice(a, 0, b, end, 0));
+
+  list_destroy(a);
+  list_destroy(b);
+}
+
+TEST_P(t_int_list, splice_within) {
+  List a = GetParam()();
+  ASSERT_NE(a, nullptr);
+  for (int i = 0; i < 10; ++i) {
+    list_push_back(a, &i);
+  }
+
+  // 5, 6 to the front
+  ListIteratorStorage storage[3];
+  ListIterator front = list_iterator_init(&storage[0], a);
+  list_iterator_start(front);
+  ListIterator from = list_iterator_init(&storage[1], a);
+  for (int i = 0; i < 5; ++i) {
+    list_iterator_next(from);
+  }
+  ListIterator to = list_iterator_init_copy(&storage[2], from);
+  list_iterator_next(to);
+  list_iterator_next(to);
+  EXPECT_EQ(LIST_SUCCESS, list_splice(a, front, a, from, to));
+  EXPECT_EQ(std::vector<int>({ 5, 6, 0, 1, 2, 3, 4, 7, 8, 9 }), int_contents(a));
+  EXPECT_EQ(5, *(int*)list_iterator_get(from));
+
+  // within a list, a range backwards or a position inside the range leaves
+  // the list as it was.
+  {
+    ListIteratorStorage more[3];
+    ListIterator one = list_iterator_init(&more[0], a);
+    ListIterator three = list_iterator_init(&more[1], a);
+    ListIterator inside = list_iterator_init(&more[2], a);
+    list_iterator_next(one);
+    for (int i = 0; i < 3; ++i) {
+      list_iterator_next(three);
+    }
+    for (int i = 0; i < 2; ++i) {
+      list_iterator_next(inside);
+    }
+    EXPECT_EQ(LIST_EINVAL, list_splice(a, 0, a, three, one));
+    EXPECT_EQ(LIST_EINVAL, list_splice(a, one, a, three, one));
+    EXPECT_EQ(LIST_EINVAL, list_splice(a, inside, a, one, three));
+    EXPECT_EQ(LIST_EINVAL, list_splice(a, inside, a, one, 0));
+    EXPECT_EQ(std::vector<int>({ 5, 6, 0, 1, 2, 3, 4, 7, 8, 9 }), int_contents(a));
+    // positions on the edges of the range move nothing
+    EXPECT_EQ(LIST_SUCCESS, list_splice(a, one, a, one, three));
+    EXPECT_EQ(LIST_SUCCESS, list_splice(a, three, a, one, three));
+    EXPECT_EQ(std::vector<int>({ 5, 6, 0, 1, 2, 3, 4, 7, 8, 9 }), int_contents(a));
+  }
+
+  list_destroy(a);
+}
+
+TEST_P(t_int_list, concat_split) {
+  List a = GetParam()(), b = GetParam()();
+  ASSERT_NE(a, nullptr);
+  ASSERT_NE(b, nullptr);
+  for (int i = 0; i < 5; ++i) {
+    list_push_back(a, &i);
+    int value = 5 + i;
+    list_push_back(b, &value);
+  }
+
+  EXPECT_EQ(LIST_EINVAL, list_concat(a, a));
+  if (!moves_between_lists(GetParam())) {
+    EXPECT_EQ(LIST_EINVAL, list_concat(a, b));
+    ListIteratorStorage storage;
+    EXPECT_EQ(nullptr, list_split_at(a, list_iterator_init(&storage, a)));
+    EXPECT_EQ(5, list_get_size(a));
+    EXPECT_EQ(5, list_get_size(b));
+    list_destroy(a);
+    list_destroy(b);
+    return;
+  }
+  EXPECT_EQ(LIST_SUCCESS, list_concat(a, b));
+  EXPECT_EQ(std::vector<int>({ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 }), int_contents(a));
+  EXPECT_TRUE(list_empty(b));
+  EXPECT_EQ(LIST_SUCCESS, list_concat(a, b));
+  list_destroy(b);
+
+  ListIteratorStorage storage;
+  ListIterator it = list_iterator_init(&storage, a);
+  for (int i = 0; i < 7; ++i) {
+    list_iterator_next(it);
+  }
+  List tail = list_split_at(a, it);
+  ASSERT_NE(nullptr, tail);
+  EXPECT_EQ(std::vector<int>({ 0, 1, 2, 3, 4, 5, 6 }), int_contents(a));
+  EXPECT_EQ(std::vector<int>({ 7, 8, 9 }), int_contents(tail));
+  EXPECT_EQ(7, *(int*)list_iterator_get(it));
+  int value = 10;
+  EXPECT_EQ(LIST_SUCCESS, list_push_back(tail, &value));
+  EXPECT_EQ(LIST_SUCCESS, list_remove_iterator(tail, it));
+  EXPECT_EQ(std::vector<int>({ 8, 9, 10 }), int_contents(tail));
+
+  // on the start edge everything moves
+  ListIterator all = list_iterator_init(&storage, a);
+  list_iterator_start(all);
+  List whole = list_split_at(a, all);
+  ASSERT_NE(nullptr, whole);
+  EXPECT_TRUE(list_empty(a));
+  EXPECT_EQ(7, list_get_size(whole));
+
+  list_destroy(a);
+  list_destroy(tail);
+  list_destroy(whole);
+}
+
+// elements move between lists, and hash indexes follow them, but not out of
+// or into slab lists.
+TEST(t_list, splice_modes) {
+  List a = int_list_create(), b = int_list_create();
+  ASSERT_EQ(LIST_SUCCESS, list_set_hash_index(a, int_hash));
+  ASSERT_EQ(LIST_SUCCESS, list_set_hash_index(b, int_hash));
+  for (int i = 0; i < 100; ++i) {
+    list_push_back(i % 2 == 0 ? a : b, &i);
+  }
+  EXPECT_EQ(LIST_SUCCESS, list_concat(a, b));
+  EXPECT_EQ(LIST_SUCCESS, list_concat(b, a));
+  EXPECT_EQ(100, list_get_size(b));
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(i, *(const int*)list_find(b, &i));
+    EXPECT_EQ(nullptr, list_find(a, &i));
+  }
+
+  List slab = int_list_create_slab();
+  int value = 100;
+  list_push_back(slab, &value);
+  EXPECT_EQ(LIST_EINVAL, list_concat(slab, b));
+  EXPECT_EQ(LIST_EINVAL, list_concat(b, slab));
+  EXPECT_EQ(LIST_EINVAL, list_merge(b, slab));
+  EXPECT_EQ(1, list_get_size(slab));
+  List inline_list = int_list_create_inline();
+  EXPECT_EQ(LIST_EINVAL, list_concat(inline_list, b));
+  List concurrent = list_create_concurrent(int_copy, int_free, int_compare);
+  EXPECT_EQ(LIST_EINVAL, list_concat(concurrent, b));
+
+  list_destroy(a);
+  list_destroy(b);
+  list_destroy(slab);
+  list_destroy(inline_list);
+  list_destroy(concurrent);
+}
+
+TEST_P(t_int_list, merge) {
+  List a = GetParam()(), b = GetParam()();
+  ASSERT_NE(a, nullptr);
+  ASSERT_NE(b, nullptr);
+  EXPECT_EQ(LIST_EINVAL, list_merge(a, a));
+  if (!moves_between_lists(GetParam())) {
+    EXPECT_EQ(LIST_EINVAL, list_merge(a, b));
+    list_destroy(a);
+    list_destroy(b);
+    return;
+  }
+  EXPECT_EQ(LIST_SUCCESS, list_merge(a, b));
+  EXPECT_TRUE(list_empty(a));
+
+  for (int i = 0; i < 20; i += 2) {
+    list_push_back(a, &i);
+    int value = i + 1;
+    list_push_back(b, &value);
+  }
+  int value = 4;
+  list_push_at(b, 2, &value);
+  EXPECT_EQ(LIST_SUCCESS, list_merge(a, b));
+  EXPECT_TRUE(list_empty(b));
+  std::vector<int> expected;
+  for (int i = 0; i < 20; ++i) {
+    expected.push_back(i);
+    if (i == 4) {
+      expected.push_back(4);
+    }
+  }
+  EXPECT_EQ(expected, int_contents(a));
+
+  // into an empty list
+  EXPECT_EQ(LIST_SUCCESS, list_merge(b, a));
+  EXPECT_EQ(expected, int_contents(b));
+
+  list_destroy(a);
+  list_destroy(b);
+}
+
+// equal elements of the first list come first.
+TEST(t_list, merge_stable) {
+  List a = list_create(string_copy, string_free, first_char_compare);
+  List b = list_create(string_copy, string_free, first_char_compare);
+  list_push_back(a, "a1");
+  list_push_back(a, "b1");
+  list_push_back(b, "a2");
+  list_push_back(b, "b2");
+  list_push_back(b, "c2");
+  ASSERT_EQ(LIST_SUCCESS, list_merge(a, b));
+  const char* expected[] = { "a1", "a2", "b1", "b2", "c2" };
+  int i = 0;
+  LIST_FOREACH_FORWARD(char*, s, a) {
+    EXPECT_STREQ(expected[i++], s);
+  }
+  list_destroy(a);
+  list_destroy(b);
+}
+
+TEST_P(t_int_list, insert_sorted) {
+  List list = GetParam()();
+  ASSERT_NE(list, nullptr);
+  int values[] = { 5, 1, 9, 3, 3, 7, 0, 10 };
+  for (int value : values) {
+    EXPECT_EQ(LIST_SUCCESS, list_insert_sorted(list, &value, nullptr));
+  }
+  EXPECT_EQ(std::vector<int>({ 0, 1, 3, 3, 5, 7, 9, 10 }), int_contents(list));
+
+  // the hint follows the new elements, forwards and backwards
+  ListIteratorStorage storage;
+  ListIterator hint = list_iterator_init(&storage, list);
+  for (int value : { 4, 6, 8, 2, 6 }) {
+    EXPECT_EQ(LIST_SUCCESS, list_insert_sorted(list, &value, hint));
+    EXPECT_EQ(value, *(int*)list_iterator_get(hint));
+  }
+  EXPECT_EQ(std::vector<int>({ 0, 1, 2, 3, 3, 4, 5, 6, 6, 7, 8, 9, 10 }), int_contents(list));
+
+  // from the edges
+  int value = -1;
+  list_iterator_end(hint);
+  EXPECT_EQ(LIST_SUCCESS, list_insert_sorted(list, &value, hint));
+  EXPECT_EQ(-1, *(int*)list_get_first(list, 0));
+  value = 11;
+  list_iterator_start(hint);
+  EXPECT_EQ(LIST_SUCCESS, list_insert_sorted(list, &value, hint));
+  EXPECT_EQ(11, *(int*)list_get_last(list, 0));
+
+  List other = GetParam()();
+  ListIterator foreign = list_iterator_init(&storage, other);
+  EXPECT_EQ(LIST_EINVAL, list_insert_sorted(list, &value, foreign));
+  EXPECT_EQ(LIST_EINVAL, list_insert_sorted(list, nullptr, nullptr));
+  list_destroy(other);
+  list_destroy(list);
+}
+
+TEST_P(t_int_list, array) {
+  List list = GetParam()();
+  ASSERT_NE(list, nullptr);
+  std::vector<int> values(1000);
+  std::vector<ListData*> pointers;
+  for (int i = 0; i < 1000; ++i) {
+    values[i] = i;
+    pointers.push_back(&values[i]);
+  }
+  EXPECT_EQ(LIST_SUCCESS, list_push_back_array(list, pointers.data(), 0, false));
+  EXPECT_EQ(LIST_SUCCESS, list_push_back_array(list, pointers.data(), 500, false));
+  ASSERT_EQ(LIST_SUCCESS, list_set_hash_index(list, int_hash));
+  EXPECT_EQ(LIST_SUCCESS, list_push_back_array(list, pointers.data() + 500, 500, false));
+  EXPECT_EQ(values, int_contents(list));
+  EXPECT_EQ(999, *(const int*)list_find(list, &values[999]));
+
+  // a NULL pointer element adds nothing
+  pointers[10] = nullptr;
+  EXPECT_EQ(LIST_EINVAL, list_push_back_array(list, pointers.data(), 20, false));
+  EXPECT_EQ(LIST_EINVAL, list_push_back_array(nullptr, pointers.data(), 5, false));
+  EXPECT_EQ(1000, list_get_size(list));
+
+  // taken elements are freed by the list
+  ListData* taken[] = { int_copy(&values[1]), int_copy(&values[2]) };
+  EXPECT_EQ(LIST_SUCCESS, list_push_back_array(list, taken, 2, true));
+  EXPECT_EQ(2, *(int*)list_get_last(list, 0));
+
+  std::vector<ListData*> out(list_get_size(list));
+  EXPECT_EQ(out.size(), list_to_array(list, out.data(), out.size()));
+  size_t i = 0;
+  LIST_FOREACH_FORWARD(int*, value, list) {
+    EXPECT_EQ(value, out[i++]);
+  }
+  EXPECT_EQ(3, list_to_array(list, out.data(), 3));
+  EXPECT_EQ(0, list_to_array(list, nullptr, 0));
+  list_destroy(list);
+}
+
+TEST(t_list, create_from_array) {
+  int values[100];
+  ListData* pointers[100];
+  for (int i = 0; i < 100; ++i) {
+    values[i] = i;
+    pointers[i] = int_copy(&values[i]);
+  }
+  List list = list_create_from_array(int_copy, int_free, int_compare, list_slab_allocator(),
+                                     pointers, 100, true);
+  ASSERT_NE(list, nullptr);
+  ListData* out[100];
+  ASSERT_EQ(100, list_to_array(list, out, 100));
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(pointers[i], out[i]);
+  }
+
+  // the nodes are consecutive in memory
+  ListNode* first = list_head(list)->next;
+  std::ptrdiff_t stride = (char*)first->next - (char*)first;
+  EXPECT_GT(stride, 0);
+  for (ListNode* node = first; node->next != list_head(list); node = node->next) {
+    EXPECT_EQ(stride, (char*)node->next - (char*)node);
+  }
+  list_destroy(list);
+
+  EXPECT_EQ(nullptr, list_create_from_array(int_copy, int_free, nullptr, list_malloc_allocator(),
+                                            pointers, 100, false));
+  List empty = list_create_from_array(int_copy, int_free, int_compare, list_malloc_allocator(),
+                                      nullptr, 0, false);
+  ASSERT_NE(empty, nullptr);
+  EXPECT_TRUE(list_empty(empty));
+  list_destroy(empty);
+}
+
+static List int_list_of(IntListFactory create, int first, int count) {
+  List list = create();
+  for (int i = first; i < first + count; ++i) {
+    list_push_back(list, &i);
+  }
+  return list;
+}
+
+static uint64_t descending_key(const ListData * i) {
+  return (uint64_t)(1000 - *(const int*)i);
+}
+
+// every change, made to a copy-on-write copy or to its source, makes the
+// changed list its own and leaves the other one as it was.
+TEST_P(t_int_list, copy_cow) {
+  IntListFactory create = GetParam();
+  typedef std::function<void(List, ListIterator)> Change;
+  int value = 7;
+  std::vector<std::pair<const char*, Change>> changes = {
+    { "push_front", [&](List l, ListIterator) { list_push_front(l, &value); } },
+    { "push_back", [&](List l, ListIterator) { list_push_back(l, &value); } },
+    { "push_at", [&](List l, ListIterator) { list_push_at(l, 3, &value); } },
+    { "push_after", [&](List l, ListIterator it) { list_push_after(l, it, &value); } },
+    { "push_before", [&](List l, ListIterator it) { list_push_before(l, it, &value); } },
+    { "push_front_take", [&](List l, ListIterator) { list_push_front_take(l, int_copy(&value)); } },
+    { "push_back_take", [&](List l, ListIterator) { list_push_back_take(l, int_copy(&value)); } },
+    { "push_at_take", [&](List l, ListIterator) { list_push_at_take(l, 3, int_copy(&value)); } },
+    { "push_after_take", [&](List l, ListIterator it) { list_push_after_take(l, it, int_copy(&value)); } },
+    { "push_before_take", [&](List l, ListIterator it) { list_push_before_take(l, it, int_copy(&value)); } },
+    { "push_back_array", [&](List l, ListIterator) {
+      ListData* data[] = { &value, &value };
+      list_push_back_array(l, data, 2, false);
+    } },
+    { "remove", [&](List l, ListIterator) { list_remove(l, &value); } },
+    { "remove_take", [&](List l, ListIterator) { int_free(list_remove_take(l, &value)); } },
+    { "pop_front", [&](List l, ListIterator) { int_free(list_pop_front(l)); } },
+    { "pop_back", [&](List l, ListIterator) { int_free(list_pop_back(l)); } },
+    { "remove_at", [&](List l, ListIterator) { list_remove_at(l, 2); } },
+    { "remove_at_take", [&](List l, ListIterator) { int_free(list_remove_at_take(l, 2)); } },
+    { "remove_iterator", [&](List l, ListIterator it) { list_remove_iterator(l, it); } },
+    { "clear", [&](List l, ListIterator it) {
+      list_clear(l);
+      list_get_first(l, it);
+    } },
+    { "sort", [&](List l, ListIterator) {
+      list_push_front(l, &value);
+      list_sort(l);
+    } },
+    { "sort_parallel", [&](List l, ListIterator) {
+      list_push_front(l, &value);
+      list_sort_parallel(l, 2);
+    } },
+    { "sort_by_key", [&](List l, ListIterator) { list_sort_by_key(l, descending_key); } },
+    { "compact", [&](List l, ListIterator it) {
+      list_compact(l);
+      list_get_first(l, it);
+    } },
+    { "splice", [&](List l, ListIterator it) {
+      ListIteratorStorage storage;
+      ListIterator first = list_iterator_init(&storage, l);
+      list_get_first(l, first);
+      list_splice(l, 0, l, first, it);
+    } },
+    { "concat", [&](List l, ListIterator) {
+      List other = int_list_of(create, 100, 3);
+      list_concat(l, other);
+      list_destroy(other);
+    } },
+    { "merge", [&](List l, ListIterator) {
+      List other = int_list_of(create, 4, 3);
+      list_merge(l, other);
+      list_destroy(other);
+    } },
+    { "split_at", [&](List l, ListIterator it) {
+      ListIteratorStorage storage;
+      list_destroy(list_split_at(l, list_iterator_init_copy(&storage, it)));
+      list_get_first(l, it);
+    } },
+    { "insert_sorted", [&](List l, ListIterator it) { list_insert_sorted(l, &value, it); } },
+    { "iterator_set", [&](List, ListIterator it) { list_iterator_set(it, &value); } },
+    { "iterator_set_take", [&](List, ListIterator it) { list_iterator_set_take(it, int_copy(&value)); } },
+  };
+
+  for (const auto & change : changes) {
+    for (bool change_copy : { false, true }) {
+      List source = int_list_of(create, 0, 20);
+      ASSERT_EQ(LIST_SUCCESS, list_set_hash_index(source, int_hash));
+      std::vector<int> original = int_contents(source);
+      List copy = list_copy_cow(source);
+      ASSERT_NE(copy, nullptr);
+      EXPECT_EQ(original, int_contents(copy));
+      List changed = change_copy ? copy : source;
+      List other = change_copy ? source : copy;
+      List expected = list_copy(source);
+
+      ListIteratorStorage storage[2];
+      ListIterator it = list_iterator_init(&storage[0], changed);
+      ListIterator expected_it = list_iterator_init(&storage[1], expected);
+      for (int i = 0; i < 5; ++i) {
+        list_get_next(changed, it);
+        list_get_next(expected, expected_it);
+      }
+      change.second(changed, it);
+      change.second(expected, expected_it);
+
+      EXPECT_EQ(original, int_contents(other)) << change.first;
+      EXPECT_EQ(int_contents(expected), int_contents(changed)) << change.first;
+      const int* at = (const int*)list_iterator_get(it);
+      const int* expected_at = (const int*)list_iterator_get(expected_it);
+      EXPECT_EQ(expected_at == nullptr, at == nullptr) << change.first;
+      if (at != nullptr && expected_at != nullptr) {
+        EXPECT_EQ(*expected_at, *at) << change.first;
+      }
+      for (int i : int_contents(changed)) {
+        EXPECT_NE(nullptr, list_find(changed, &i)) << change.first;
+      }
+      for (int i : original) {
+        EXPECT_NE(nullptr, list_find(other, &i)) << change.first;
+      }
+
+      // and each list goes on on its own.
+      EXPECT_EQ(LIST_SUCCESS, list_push_back(other, &value));
+      EXPECT_EQ(original.size() + 1, list_get_size(other));
+      list_destroy(source);
+      list_destroy(copy);
+      list_destroy(expected);
+    }
+  }
+}
+
+// copies share the hash index along with the nodes, until each changes or
+// drops it.
+TEST(t_list, copy_cow_index) {
+  List list = int_list_of(int_list_create, 0, 100);
+  ASSERT_EQ(LIST_SUCCESS, list_set_hash_index(list, int_hash));
+  List copy = list_copy_cow(list);
+  List snapshot = list_snapshot(list);
+  ASSERT_NE(nullptr, copy);
+  ASSERT_NE(nullptr, snapshot);
+  int value = 50;
+  EXPECT_EQ(LIST_SUCCESS, list_set_hash_index(copy, nullptr));
+  EXPECT_EQ(50, *(const int*)list_find(copy, &value));
+  EXPECT_EQ(LIST_SUCCESS, list_remove(list, &value));
+  EXPECT_EQ(nullptr, list_find(list, &value));
+  EXPECT_EQ(50, *(const int*)list_find(snapshot, &value));
+  list_destroy(list);
+  EXPECT_EQ(50, *(const int*)list_find(snapshot, &value));
+  list_clear(copy);
+  EXPECT_EQ(50, *(const int*)list_find(snapshot, &value));
+  list_destroy(snapshot);
+  list_destroy(copy);
+}
+
+TEST(t_list, copy_cow_shares) {
+  List list = int_list_of(int_list_create, 0, 100);
+  List copy = list_copy_cow(list);
+  List second = list_copy_cow(copy);
+  ASSERT_NE(copy, nullptr);
+  ASSERT_NE(second, nullptr);
+  EXPECT_EQ(list_head(list), list_head(copy));
+  EXPECT_EQ(list_head(list), list_head(second));
+  // the nodes outlive the list which made them.
+  list_destroy(list);
+  EXPECT_EQ(100, list_get_size(second));
+  int value = 0;
+  EXPECT_EQ(LIST_SUCCESS, list_remove(copy, &value));
+  EXPECT_NE(list_head(copy), list_head(second));
+  EXPECT_EQ(99, list_get_size(copy));
+  // the last list left owns the nodes without copying them.
+  ListNode* head = list_head(second);
+  EXPECT_EQ(LIST_SUCCESS, list_remove(second, &value));
+  EXPECT_EQ(head, list_head(second));
+  list_destroy(copy);
+  list_destroy(second);
+
+  // clearing leaves the nodes to the copy.
+  list = int_list_of(int_list_create, 0, 10);
+  copy = list_copy_cow(list);
+  list_clear(list);
+  EXPECT_TRUE(list_empty(list));
+  EXPECT_EQ(10, list_get_size(copy));
+  list_destroy(list);
+  list_destroy(copy);
+
+  EXPECT_EQ(nullptr, list_copy_cow(nullptr));
+}
+
+// a copy is processed in the background while the list goes on changing.
+TEST(t_list, copy_cow_threads) {
+  List list = int_list_of(int_list_create, 0, 1000);
+  for (int round = 0; round < 10; ++round) {
+    List snapshot = list_copy_cow(list);
+    ASSERT_NE(snapshot, nullptr);
+    std::thread reader([snapshot, round] {
+      long sum = 0;
+      LIST_FOREACH_FORWARD(int*, i, snapshot) {
+        sum += *i;
+      }
+      EXPECT_EQ(1000 * 999 / 2 + round * 1000L, sum);
+      list_destroy(snapshot);
+    });
+    for (int i = 0; i < 1000; ++i) {
+      int* value = (int*)list_pop_front(list);
+      *value += 1;
+      list_push_back_take(list, value);
+    }
+    reader.join();
+  }
+  list_destroy(list);
+}
+
+TEST_P(t_int_list, snapshot) {
+  List list = int_list_of(GetParam(), 0, 10);
+  ASSERT_NE(list, nullptr);
+  List first = list_snapshot(list);
+  ASSERT_NE(first, nullptr);
+  List same = list_snapshot(list);
+  ASSERT_NE(same, nullptr);
+
+  // the list changes, the snapshots do not.
+  int value = 10;
+  EXPECT_EQ(LIST_SUCCESS, list_push_back(list, &value));
+  int_free(list_pop_front(list));
+  List second = list_snapshot(list);
+  ASSERT_NE(second, nullptr);
+  list_clear(list);
+  EXPECT_TRUE(list_empty(list));
+
+  std::vector<int> expected = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+  EXPECT_EQ(expected, int_contents(first));
+  EXPECT_EQ(expected, int_contents(same));
+  expected.erase(expected.begin());
+  expected.push_back(10);
+  EXPECT_EQ(expected, int_contents(second));
+
+  // read with iterators as any list
+  ListIteratorStorage storage;
+  ListIterator it = list_iterator_init(&storage, second);
+  int i = 0;
+  for (ListIteratorStatus stat = list_iterator_first(it); stat != LIST_ITERATOR_END; stat = list_iterator_next(it)) {
+    EXPECT_EQ(expected[i++], *(int*)list_iterator_get(it));
+  }
+  value = 5;
+  EXPECT_EQ(5, *(const int*)list_find(second, &value));
+
+  // but not changed
+  list_iterator_first(it);
+  EXPECT_EQ(LIST_EINVAL, list_push_back(second, &value));
+  EXPECT_EQ(LIST_EINVAL, list_push_after(second, it, &value));
+  EXPECT_EQ(LIST_EINVAL, list_remove(second, &value));
+  EXPECT_EQ(nullptr, list_pop_front(second));
+  EXPECT_EQ(nullptr, list_remove_at_take(second, 0));
+  EXPECT_EQ(LIST_EINVAL, list_remove_iterator(second, it));
+  EXPECT_EQ(LIST_EINVAL, list_sort(second));
+  EXPECT_EQ(LIST_EINVAL, list_concat(list, second));
+  EXPECT_EQ(LIST_EINVAL, list_concat(second, first));
+  EXPECT_EQ(nullptr, list_split_at(second, it));
+  EXPECT_EQ(LIST_ITERATOR_EINVAL, list_iterator_set(it, &value));
+  list_clear(second);
+  EXPECT_EQ(expected, int_contents(second));
+
+  // copies of a snapshot can change
+  List copy = list_copy(second);
+  EXPECT_EQ(LIST_SUCCESS, list_push_back(copy, &value));
+  list_destroy(copy);
+
+  list_destroy(first);
+  list_destroy(same);
+  list_destroy(second);
+  list_destroy(list);
+}
+
+static bool is_even(const ListData * i, void * calls) {
+  ++*(int*)calls;
+  return *(const int*)i % 2 == 0;
+}
+
+TEST_P(t_int_list, remove_if) {
+  List list = int_list_of(GetParam(), 0, 1000);
+  ASSERT_NE(list, nullptr);
+  int calls = 0;
+  EXPECT_EQ(0, list_remove_if(nullptr, is_even, &calls));
+  EXPECT_EQ(0, list_remove_if(list, nullptr, &calls));
+  EXPECT_EQ(500, list_remove_if(list, is_even, &calls));
+  EXPECT_EQ(1000, calls);
+  std::vector<int> expected;
+  for (int i = 1; i < 1000; i += 2) {
+    expected.push_back(i);
+  }
+  EXPECT_EQ(expected, int_contents(list));
+  EXPECT_EQ(0, list_remove_if(list, is_even, &calls));
+
+  // equal elements anywhere in the list, with and without an index
+  for (bool index : { false, true }) {
+    if (index) {
+      ASSERT_EQ(LIST_SUCCESS, list_set_hash_index(list, int_hash));
+    }
+    int value = 3000;
+    list_push_front(list, &value);
+    list_push_at(list, 100, &value);
+    list_push_back(list, &value);
+    EXPECT_EQ(3, list_remove_all(list, &value));
+    EXPECT_EQ(0, list_remove_all(list, &value));
+    EXPECT_EQ(nullptr, list_find(list, &value));
+    EXPECT_EQ(expected, int_contents(list));
+  }
+  EXPECT_EQ(0, list_remove_all(list, nullptr));
+  int value = 999;
+  EXPECT_EQ(1, list_remove_all(list, &value));
+  EXPECT_EQ(nullptr, list_find(list, &value));
+
+  // snapshots do not change, and the list does not change under them.
+  List snapshot = list_snapshot(list);
+  EXPECT_EQ(0, list_remove_all(snapshot, &expected[0]));
+  EXPECT_EQ(1, list_remove_all(list, &expected[0]));
+  EXPECT_EQ(expected.size() - 1, list_get_size(snapshot));
+  list_destroy(snapshot);
+  list_destroy(list);
+}
+
+TEST_P(t_int_list, clear_async) {
+  ListReclaimer reclaimer = list_reclaimer_create(false);
+  ASSERT_NE(nullptr, reclaimer);
+  EXPECT_EQ(0, list_reclaim_step(nullptr, 10));
+  EXPECT_EQ(0, list_reclaim_step(reclaimer, 10));
+
+  List list = int_list_of(GetParam(), 0, 1000);
+  ASSERT_EQ(LIST_SUCCESS, list_set_hash_index(list, int_hash));
+  list_clear_async(list, reclaimer);
+  EXPECT_TRUE(list_empty(list));
+
+  // the list is usable right away, before anything is reclaimed
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(LIST_SUCCESS, list_push_back(list, &i));
+  }
+  int value = 5;
+  EXPECT_EQ(5, *(int*)list_find(list, &value));
+  value = 500;
+  EXPECT_EQ(nullptr, list_find(list, &value));
+  EXPECT_EQ((std::vector<int>{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 }), int_contents(list));
+
+  // inline elements from a released allocator state take no walk.
+  size_t reclaimed = list_reclaim_step(reclaimer, 100);
+  EXPECT_GE(reclaimed, 100);
+  reclaimed += list_reclaim_step(reclaimer, SIZE_MAX);
+  EXPECT_EQ(1000, reclaimed);
+  EXPECT_EQ(0, list_reclaim_step(reclaimer, SIZE_MAX));
+  EXPECT_EQ(10, list_get_size(list));
+
+  // without a reclaimer the list is cleared right away.
+  list_clear_async(list, nullptr);
+  EXPECT_TRUE(list_empty(list));
+  list_push_back(list, &value);
+
+  // snapshots stay as they are.
+  List snapshot = list_snapshot(list);
+  list_clear_async(snapshot, reclaimer);
+  EXPECT_EQ(1, list_get_size(snapshot));
+  list_destroy_async(snapshot, reclaimer);
+
+  // what is left is freed along with the reclaimer.
+  list_destroy_async(list, reclaimer);
+  list_destroy_async(nullptr, reclaimer);
+  list_reclaimer_destroy(reclaimer);
+  list_reclaimer_destroy(nullptr);
+}
+
+static std::atomic<int> async_freed(0);
+
+static void async_counting_free(ListData * data) {
+  int_free(data);
+  ++async_freed;
+}
+
+// a list is cleared and refilled while a reclaimer thread frees what it held.
+TEST(t_list, clear_async_background) {
+  ListReclaimer reclaimer = list_reclaimer_create(true);
+  ASSERT_NE(nullptr, reclaimer);
+  async_freed = 0;
+  List list = list_create(int_copy, async_counting_free, int_compare);
+  const int rounds = 10, size = 10000;
+  for (int round = 0; round < rounds; ++round) {
+    for (int i = 0; i < size; ++i) {
+      list_push_back(list, &i);
+    }
+    list_clear_async(list, reclaimer);
+    EXPECT_TRUE(list_empty(list));
+  }
+  for (int i = 0; i < 100 && async_freed < rounds * size; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(rounds * size, async_freed);
+
+  // copy-on-write copies keep the nodes, until the last one leaves.
+  for (int i = 0; i < size; ++i) {
+    list_push_back(list, &i);
+  }
+  List copy = list_copy_cow(list);
+  List second = list_copy_cow(list);
+  list_destroy_async(list, reclaimer);
+  list_clear_async(copy, reclaimer);
+  EXPECT_TRUE(list_empty(copy));
+  EXPECT_EQ(size, list_get_size(second));
+  EXPECT_EQ(size - 1, *(int*)list_get_last(second, 0));
+  list_destroy_async(second, reclaimer);
+  list_destroy_async(copy, reclaimer);
+  list_reclaimer_destroy(reclaimer);
+  EXPECT_EQ((rounds + 1) * size, async_freed);
+}
@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+#include "ListTestTypes.hpp" // int_copy, int_free, string_copy, string_free
+#include <atomic>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include "list.h"
+}
+
+TEST(t_queue, general) {
+  EXPECT_EQ(nullptr, list_queue_create(nullptr, int_free));
+  ListQueue queue = list_queue_create(int_copy, int_free);
+  ASSERT_NE(nullptr, queue);
+  EXPECT_EQ(nullptr, list_queue_pop(queue));
+  EXPECT_EQ(LIST_EINVAL, list_queue_push(queue, nullptr));
+  EXPECT_EQ(LIST_EINVAL, list_queue_push(nullptr, &queue));
+
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_EQ(LIST_SUCCESS, list_queue_push(queue, &i));
+  }
+  for (int i = 0; i < 1000; ++i) {
+    int* value = (int*)list_queue_pop(queue);
+    ASSERT_NE(nullptr, value);
+    EXPECT_EQ(i, *value);
+    int_free(value);
+  }
+  EXPECT_EQ(nullptr, list_queue_pop(queue));
+
+  // elements left in the queue are freed with it
+  int value = 7;
+  EXPECT_EQ(LIST_SUCCESS, list_queue_push(queue, &value));
+  list_queue_destroy(queue);
+}
+
+TEST(t_queue, take) {
+  ListQueue queue = list_queue_create(string_copy, string_free);
+  ASSERT_NE(nullptr, queue);
+  char* s = (char*)string_copy("taken");
+  EXPECT_EQ(LIST_SUCCESS, list_queue_push_take(queue, s));
+  EXPECT_EQ(LIST_SUCCESS, list_queue_push(queue, "copied"));
+
+  // the same element comes back, and belongs to the caller again
+  char* popped = (char*)list_queue_pop(queue);
+  EXPECT_EQ(s, popped);
+  string_free(popped);
+  popped = (char*)list_queue_pop(queue);
+  EXPECT_STREQ("copied", popped);
+  string_free(popped);
+  list_queue_destroy(queue);
+}
+
+// every element is popped exactly once, and the elements of each producer
+// reach each consumer in the order they were pushed.
+TEST(t_queue, producers_consumers) {
+  ListQueue queue = list_queue_create(int_copy, int_free);
+  ASSERT_NE(nullptr, queue);
+  const int producers = 4, consumers = 4, per_producer = 50000;
+  std::vector<std::atomic<int>> seen(producers * per_producer);
+  std::atomic<int> consumed(0);
+
+  std::vector<std::thread> workers;
+  for (int p = 0; p < producers; ++p) {
+    workers.emplace_back([queue, p]() {
+      for (int i = p * per_producer; i < (p + 1) * per_producer; ++i) {
+        ASSERT_EQ(LIST_SUCCESS, list_queue_push(queue, &i));
+      }
+    });
+  }
+  for (int c = 0; c < consumers; ++c) {
+    workers.emplace_back([queue, &seen, &consumed]() {
+      std::vector<int> last(producers, -1);
+      while (consumed < producers * per_producer) {
+        int* value = (int*)list_queue_pop(queue);
+        if (value == nullptr) {
+          std::this_thread::yield();
+          continue;
+        }
+        int producer = *value / per_producer;
+        EXPECT_LT(last[producer], *value);
+        last[producer] = *value;
+        ++seen[*value];
+        ++consumed;
+        int_free(value);
+      }
+    });
+  }
+  for (auto & worker : workers) {
+    worker.join();
+  }
+
+  for (auto & count : seen) {
+    EXPECT_EQ(1, count);
+  }
+  EXPECT_EQ(nullptr, list_queue_pop(queue));
+  list_queue_destroy(queue);
+}
+
+// threads join in while others are busy, so hazard records are added to the
+// queue while other threads scan them for the nodes they may free.
+TEST(t_queue, records_added) {
+  ListQueue queue = list_queue_create(int_copy, int_free);
+  ASSERT_NE(nullptr, queue);
+  const int threads = 16, rounds = 20000;
+  std::atomic<int> pushed(0), popped(0);
+
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([queue, rounds, &pushed, &popped]() {
+      for (int i = 0; i < rounds; ++i) {
+        ASSERT_EQ(LIST_SUCCESS, list_queue_push(queue, &i));
+        ++pushed;
+        int* value = (int*)list_queue_pop(queue);
+        if (value != nullptr) {
+          EXPECT_LE(0, *value);
+          EXPECT_GT(rounds, *value);
+          int_free(value);
+          ++popped;
+        }
+      }
+    });
+    std::this_thread::yield();
+  }
+  for (auto & worker : workers) {
+    worker.join();
+  }
+
+  while (int* value = (int*)list_queue_pop(queue)) {
+    int_free(value);
+    ++popped;
+  }
+  EXPECT_EQ(threads * rounds, pushed);
+  EXPECT_EQ(pushed, popped);
+  list_queue_destroy(queue);
+}
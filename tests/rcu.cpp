@@ -0,0 +1,298 @@
+#include <gtest/gtest.h>
+#include "ListTestTypes.hpp" // int_copy, int_free, int_compare
+#include <atomic>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include "list.h"
+}
+
+// elements freed so far, to tell when removed nodes are reclaimed.
+static std::atomic<int> freed(0);
+
+static void counting_free(ListData* data) {
+  ++freed;
+  int_free(data);
+}
+
+TEST(t_rcu_list, create) {
+  List list = list_create_rcu(int_copy, int_free, int_compare);
+  ASSERT_NE(nullptr, list);
+  EXPECT_EQ(nullptr, list_create_rcu(nullptr, int_free, int_compare));
+  EXPECT_EQ(LIST_EINVAL, list_set_hash_index(list, [](const ListData * i) {
+    return (size_t)*(const int*)i;
+  }));
+  EXPECT_EQ(LIST_EINVAL, list_sort(list));
+  EXPECT_EQ(LIST_EINVAL, list_sort_parallel(list, 2));
+  EXPECT_EQ(LIST_EINVAL, list_compact(list));
+
+  List plain = list_create(int_copy, int_free, int_compare);
+  EXPECT_EQ(nullptr, list_rcu_register(plain));
+  EXPECT_EQ(LIST_EINVAL, list_rcu_synchronize(plain));
+  list_destroy(plain);
+
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(LIST_SUCCESS, list_push_back(list, &i));
+  }
+  ListReader reader = list_rcu_register(list);
+  ASSERT_NE(nullptr, reader);
+  list_rcu_read_lock(reader);
+  list_rcu_read_lock(reader);
+  int expected = 0;
+  LIST_FOREACH_FORWARD(int*, i, list) {
+    EXPECT_EQ(expected++, *i);
+  }
+  EXPECT_EQ(10, expected);
+  EXPECT_EQ(3, *(int*)list_get_at(list, 3));
+  int value = 7;
+  EXPECT_NE(nullptr, list_find(list, &value));
+  list_rcu_read_unlock(reader);
+  list_rcu_read_unlock(reader);
+
+  EXPECT_EQ(LIST_SUCCESS, list_remove(list, &value));
+  int* popped = (int*)list_pop_front(list);
+  EXPECT_EQ(0, *popped);
+  int_free(popped);
+
+  ListIteratorStorage storage;
+  ListIterator it = list_iterator_init(&storage, list);
+  value = 100;
+  EXPECT_EQ(LIST_ITERATOR_SUCCESS, list_iterator_set(it, &value));
+  EXPECT_EQ(100, *(int*)list_get_first(list, 0));
+  EXPECT_EQ(LIST_SUCCESS, list_remove_iterator(list, it));
+  EXPECT_EQ(2, *(int*)list_iterator_get(it));
+  EXPECT_EQ(LIST_SUCCESS, list_rcu_synchronize(list));
+
+  List copy = list_copy(list);
+  ASSERT_NE(nullptr, copy);
+  EXPECT_EQ(7, list_get_size(copy));
+  EXPECT_EQ(LIST_EINVAL, list_sort(copy));
+  list_destroy(copy);
+
+  int values[] = { 20, 21, 22 };
+  ListData* pointers[] = { &values[0], &values[1], &values[2] };
+  EXPECT_EQ(LIST_SUCCESS, list_push_back_array(list, pointers, 3, false));
+  ListData* out[10];
+  EXPECT_EQ(10, list_to_array(list, out, 10));
+  EXPECT_EQ(22, *(int*)out[9]);
+  EXPECT_EQ(3, list_remove_if(list, [](const ListData * i, void *) {
+    return *(const int*)i >= 20;
+  }, nullptr));
+  EXPECT_EQ(7, list_get_size(list));
+
+  list_clear(list);
+  EXPECT_TRUE(list_empty(list));
+  list_rcu_unregister(reader);
+  list_destroy(list);
+}
+
+// removed elements outlive the read-side sections which may see them.
+TEST(t_rcu_list, grace_period) {
+  List list = list_create_rcu(int_copy, counting_free, int_compare);
+  ASSERT_NE(nullptr, list);
+  for (int i = 0; i < 3; ++i) {
+    list_push_back(list, &i);
+  }
+  freed = 0;
+
+  ListReader reader = list_rcu_register(list);
+  std::atomic<bool> inside(false), done(false);
+  std::thread thread([list, reader, &inside, &done]() {
+    list_rcu_read_lock(reader);
+    int* first = (int*)list_get_first(list, 0);
+    inside = true;
+    while (!done) {
+      std::this_thread::yield();
+    }
+    // the element was removed meanwhile, but is still there.
+    EXPECT_EQ(0, *first);
+    list_rcu_read_unlock(reader);
+  });
+  while (!inside) {
+    std::this_thread::yield();
+  }
+
+  int value = 0;
+  EXPECT_EQ(LIST_SUCCESS, list_remove(list, &value));
+  EXPECT_EQ(0, freed);
+  std::thread writer([list]() {
+    list_rcu_synchronize(list);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_EQ(0, freed);
+  done = true;
+  writer.join();
+  thread.join();
+  EXPECT_EQ(1, freed);
+
+  list_rcu_unregister(reader);
+  list_destroy(list);
+}
+
+// readers see a consistent list while a writer churns through it.
+TEST(t_rcu_list, readers_writer) {
+  List list = list_create_rcu(int_copy, int_free, int_compare);
+  ASSERT_NE(nullptr, list);
+  const int size = 100, rounds = 500, readers = 2;
+  for (int i = 0; i < size; ++i) {
+    list_push_back(list, &i);
+  }
+
+  std::atomic<bool> done(false);
+  std::atomic<int> started(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < readers; ++t) {
+    threads.emplace_back([list, &done, &started]() {
+      ListReader reader = list_rcu_register(list);
+      ASSERT_NE(nullptr, reader);
+      ++started;
+      while (!done) {
+        list_rcu_read_lock(reader);
+        // the elements are pushed at the back in increasing order, and
+        // removed at the front or replaced by negative values.
+        int last = -1;
+        LIST_FOREACH_FORWARD(int*, i, list) {
+          if (*i >= 0) {
+            EXPECT_LT(last, *i);
+            last = *i;
+          }
+        }
+        last = size * rounds;
+        LIST_FOREACH_BACKWARD(int*, i, list) {
+          if (*i >= 0) {
+            EXPECT_GT(last, *i);
+            last = *i;
+          }
+        }
+        list_rcu_read_unlock(reader);
+      }
+      list_rcu_unregister(reader);
+    });
+  }
+
+  while (started < readers) {
+    std::this_thread::yield();
+  }
+  for (int round = 0; round < rounds; ++round) {
+    int value = size + round;
+    ASSERT_EQ(LIST_SUCCESS, list_push_back(list, &value));
+    if (round % 3 == 0) {
+      int* popped = (int*)list_pop_front(list);
+      ASSERT_NE(nullptr, popped);
+      int_free(popped);
+    } else if (round % 3 == 1) {
+      ASSERT_EQ(LIST_SUCCESS, list_remove_at(list, 0));
+    } else {
+      ListIteratorStorage storage;
+      ListIterator it = list_iterator_init(&storage, list);
+      value = -1;
+      ASSERT_EQ(LIST_ITERATOR_SUCCESS, list_iterator_set(it, &value));
+      ASSERT_EQ(LIST_SUCCESS, list_remove_iterator(list, it));
+    }
+  }
+  done = true;
+  for (auto & thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ((size_t)size, list_get_size(list));
+  list_destroy(list);
+}
+
+// readers walking the list while the evens are removed in one pass see every
+// odd element, in order.
+TEST(t_rcu_list, remove_if) {
+  List list = list_create_rcu(int_copy, int_free, int_compare);
+  ASSERT_NE(nullptr, list);
+  const int size = 20000, readers = 2;
+  for (int i = 0; i < size; ++i) {
+    list_push_back(list, &i);
+  }
+
+  std::atomic<bool> done(false);
+  std::atomic<int> started(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < readers; ++t) {
+    threads.emplace_back([list, &done, &started]() {
+      ListReader reader = list_rcu_register(list);
+      ASSERT_NE(nullptr, reader);
+      ++started;
+      do {
+        list_rcu_read_lock(reader);
+        int odd = 1;
+        LIST_FOREACH_FORWARD(int*, i, list) {
+          if (*i % 2 != 0) {
+            EXPECT_EQ(odd, *i);
+            odd += 2;
+          }
+        }
+        EXPECT_EQ(size + 1, odd);
+        list_rcu_read_unlock(reader);
+      } while (!done);
+      list_rcu_unregister(reader);
+    });
+  }
+
+  while (started < readers) {
+    std::this_thread::yield();
+  }
+  EXPECT_EQ((size_t)size / 2, list_remove_if(list, [](const ListData * i, void *) {
+    return *(const int*)i % 2 == 0;
+  }, nullptr));
+  done = true;
+  for (auto & thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ((size_t)size / 2, list_get_size(list));
+  list_destroy(list);
+}
+
+// readers go on through the nodes of a list which is cleared under them,
+// until they leave their read-side sections.
+TEST(t_rcu_list, clear_async) {
+  List list = list_create_rcu(int_copy, int_free, int_compare);
+  ASSERT_NE(nullptr, list);
+  ListReclaimer reclaimer = list_reclaimer_create(true);
+  ASSERT_NE(nullptr, reclaimer);
+  const int size = 1000, rounds = 50, readers = 2;
+
+  std::atomic<bool> done(false);
+  std::atomic<int> started(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < readers; ++t) {
+    threads.emplace_back([list, &done, &started]() {
+      ListReader reader = list_rcu_register(list);
+      ASSERT_NE(nullptr, reader);
+      ++started;
+      while (!done) {
+        list_rcu_read_lock(reader);
+        int expected = 0;
+        LIST_FOREACH_FORWARD(int*, i, list) {
+          EXPECT_EQ(expected++, *i);
+        }
+        list_rcu_read_unlock(reader);
+      }
+      list_rcu_unregister(reader);
+    });
+  }
+
+  while (started < readers) {
+    std::this_thread::yield();
+  }
+  for (int round = 0; round < rounds; ++round) {
+    for (int i = 0; i < size; ++i) {
+      ASSERT_EQ(LIST_SUCCESS, list_push_back(list, &i));
+    }
+    list_clear_async(list, reclaimer);
+    EXPECT_TRUE(list_empty(list));
+  }
+  done = true;
+  for (auto & thread : threads) {
+    thread.join();
+  }
+
+  list_destroy_async(list, reclaimer);
+  list_reclaimer_destroy(reclaimer);
+}
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+
+extern "C" {
+#include "list_typed.h"
+}
+
+typedef struct {
+  int x, y;
+} Point;
+
+static int point_compare(Point a, Point b) {
+  return (a.x != b.x) ? LIST_COMPARE_VALUES(a.x, b.x) : LIST_COMPARE_VALUES(a.y, b.y);
+}
+
+LIST_DECLARE(intlist, int)
+LIST_DECLARE(doublelist, double)
+LIST_DECLARE_CMP(pointlist, Point, point_compare)
+
+TEST(t_typed_list, general) {
+  intlist * list = intlist_create();
+  ASSERT_NE(nullptr, list);
+  EXPECT_EQ(nullptr, intlist_front(list));
+  EXPECT_FALSE(intlist_pop_front(list, nullptr));
+
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(LIST_SUCCESS, intlist_push_back(list, i));
+  }
+  EXPECT_EQ(LIST_SUCCESS, intlist_push_front(list, -1));
+  EXPECT_EQ(11, intlist_size(list));
+  EXPECT_EQ(-1, *intlist_front(list));
+  EXPECT_EQ(9, *intlist_back(list));
+  EXPECT_EQ(4, *intlist_at(list, 5));
+
+  int expected = -1;
+  LIST_TYPED_FOREACH(int, value, list) {
+    EXPECT_EQ(expected++, *value);
+    *value *= 2;
+  }
+  EXPECT_EQ(8, *intlist_find(list, 8));
+  EXPECT_EQ(nullptr, intlist_find(list, 7));
+
+  int value;
+  EXPECT_TRUE(intlist_pop_front(list, &value));
+  EXPECT_EQ(-2, value);
+  EXPECT_TRUE(intlist_pop_back(list, &value));
+  EXPECT_EQ(18, value);
+  EXPECT_EQ(9, intlist_size(list));
+
+  // the generic functions work on the same list.
+  EXPECT_EQ(LIST_SUCCESS, list_push_front(intlist_list(list), &value));
+  EXPECT_EQ(LIST_SUCCESS, intlist_sort(list));
+  EXPECT_EQ(0, *intlist_front(list));
+  EXPECT_EQ(18, *intlist_back(list));
+  intlist_destroy(list);
+}
+
+TEST(t_typed_list, types) {
+  doublelist * doubles = doublelist_create_with_allocator(list_slab_allocator());
+  ASSERT_NE(nullptr, doubles);
+  for (int i = 10; i > 0; --i) {
+    doublelist_push_back(doubles, i / 4.0);
+  }
+  EXPECT_EQ(LIST_SUCCESS, doublelist_sort(doubles));
+  double last = 0;
+  LIST_TYPED_FOREACH(double, value, doubles) {
+    EXPECT_LT(last, *value);
+    last = *value;
+  }
+  EXPECT_EQ(0.5, *doublelist_find(doubles, 0.5));
+  doublelist_destroy(doubles);
+
+  pointlist * points = pointlist_create();
+  ASSERT_NE(nullptr, points);
+  pointlist_push_back(points, Point{ 1, 2 });
+  pointlist_push_back(points, Point{ 1, 1 });
+  pointlist_push_back(points, Point{ 0, 5 });
+  EXPECT_EQ(LIST_SUCCESS, pointlist_sort(points));
+  Point point;
+  EXPECT_TRUE(pointlist_pop_front(points, &point));
+  EXPECT_EQ(0, point.x);
+  EXPECT_EQ(1, pointlist_front(points)->y);
+  EXPECT_NE(nullptr, pointlist_find(points, Point{ 1, 2 }));
+  EXPECT_EQ(nullptr, pointlist_find(points, Point{ 2, 1 }));
+  pointlist_destroy(points);
+}